@@ -0,0 +1,302 @@
+/*
+  ==============================================================================
+
+    Command-line entry point that measures what running the three stages as
+    one chain costs against three separate processors, and the flanger and
+    chorus against the juce::dsp effects they replaced. It is built as a
+    console target from the chain's sources, with the same JucePlugin_*
+    settings and EMBEDDED_ENGINE=1.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <limits>
+#include "PluginProcessor.h"
+#include "../Shared/RealtimeSafety.h"
+
+namespace
+{
+    const int numRepeats = 3;
+    const int numVoices = 8;
+
+    // Both setups run the same chorus settings, whatever the defaults become.
+    void setUpChorusFlanger(ChorusFlangerAudioProcessor& processor)
+    {
+        const std::pair<const char*, float> settings[] = {
+            { "mode", 0.0f }, { "rate", 1.0f }, { "depth", 0.5f }, { "delay", 7.0f }, { "feedback", 0.0f }
+        };
+        for (const auto& [parameterID, value] : settings)
+            if (auto* parameter = processor.parameters.getParameter(parameterID))
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    void holdNotes(juce::MidiBuffer& midi)
+    {
+        for (int voice = 0; voice < numVoices; ++voice)
+            midi.addEvent(juce::MidiMessage::noteOn(1, 48 + voice, (juce::uint8)100), 0);
+    }
+
+    // Best of a few runs of numBlocks calls, in nanoseconds per block.
+    template <typename Function>
+    double measureBlocks(int numBlocks, Function&& processOneBlock)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            for (int block = 0; block < numBlocks; ++block)
+                processOneBlock();
+            const auto ticks = juce::Time::getHighResolutionTicks() - startTicks;
+            best = juce::jmin(best, juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9 / numBlocks);
+        }
+        return best;
+    }
+
+    // The three processors one after another on one buffer, as a host runs three instances.
+    double benchmarkSeparate(double sampleRate, int blockSize, double seconds)
+    {
+        SynthAudioProcessor synth;
+        TremoloAudioProcessor tremolo;
+        ChorusFlangerAudioProcessor chorusFlanger;
+        setUpChorusFlanger(chorusFlanger);
+        juce::AudioProcessor* processors[] = { &synth, &tremolo, &chorusFlanger };
+
+        synth.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+        tremolo.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+        chorusFlanger.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+        for (auto* processor : processors)
+            processor->prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        holdNotes(midi);
+        for (auto* processor : processors)
+            processor->processBlock(buffer, midi);
+        midi.clear();
+
+        const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+        const auto nanoseconds = measureBlocks(numBlocks, [&]
+        {
+            for (auto* processor : processors)
+                processor->processBlock(buffer, midi);
+        });
+
+        for (auto* processor : processors)
+            processor->releaseResources();
+        return nanoseconds;
+    }
+
+    double benchmarkChain(double sampleRate, int blockSize, double seconds, bool bypassAll)
+    {
+        ChainAudioProcessor chain;
+        setUpChorusFlanger(chain.chorusFlanger);
+        chain.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+        chain.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        holdNotes(midi);
+        chain.processBlock(buffer, midi);
+        midi.clear();
+
+        if (bypassAll)
+        {
+            for (int stage = 0; stage < ChainAudioProcessor::numStages; ++stage)
+                if (auto* parameter = chain.parameters.getParameter(ChainAudioProcessor::getBypassParameterID((ChainAudioProcessor::Stage)stage)))
+                    parameter->setValueNotifyingHost(1.0f);
+            // Past the fade-out, so only the bypassed blocks are timed.
+            chain.processBlock(buffer, midi);
+        }
+
+        const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+        const auto nanoseconds = measureBlocks(numBlocks, [&] { chain.processBlock(buffer, midi); });
+
+        chain.releaseResources();
+        return nanoseconds;
+    }
+
+    // The Chorus/Flanger's flanger in each interpolation mode, against the juce::dsp::Phaser
+    // it replaced, set up per block the way the processor used to.
+    juce::var benchmarkFlanger(double sampleRate, int blockSize, double seconds)
+    {
+        const float rate = 0.5f, depth = 0.6f, delay = 2.0f, feedback = 0.5f;
+        const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::Random random(1);
+        auto fillWithNoise = [&]
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                for (int i = 0; i < blockSize; ++i)
+                    buffer.setSample(channel, i, random.nextFloat() - 0.5f);
+        };
+        juce::Array<juce::var> results;
+
+        juce::dsp::Phaser<float> phaser;
+        phaser.prepare({ sampleRate, (juce::uint32)blockSize, 2 });
+        fillWithNoise();
+        const auto phaserNanoseconds = measureBlocks(numBlocks, [&]
+        {
+            phaser.setRate(rate);
+            phaser.setDepth(depth);
+            phaser.setCentreFrequency(1 / delay);
+            phaser.setFeedback(feedback);
+            phaser.setMix(1);
+            juce::dsp::AudioBlock<float> block(buffer);
+            phaser.process(juce::dsp::ProcessContextReplacing<float>(block));
+        });
+        juce::DynamicObject::Ptr phaserResult = new juce::DynamicObject();
+        phaserResult->setProperty("effect", "Phaser");
+        phaserResult->setProperty("nsPerSample", phaserNanoseconds / blockSize);
+        results.add(phaserResult.get());
+
+        for (auto mode : { Flanger::LinearInterpolation, Flanger::CubicInterpolation, Flanger::AllpassInterpolation })
+        {
+            Flanger flanger;
+            flanger.setParameters(rate, depth, delay, feedback);
+            flanger.setInterpolation(mode);
+            flanger.prepare(sampleRate, blockSize);
+            fillWithNoise();
+            const auto nanoseconds = measureBlocks(numBlocks, [&]
+            {
+                flanger.setParameters(rate, depth, delay, feedback);
+                flanger.process(buffer, 0, blockSize);
+            });
+
+            juce::DynamicObject::Ptr result = new juce::DynamicObject();
+            result->setProperty("effect", mode == Flanger::LinearInterpolation ? "Flanger (linear)"
+                                          : mode == Flanger::CubicInterpolation ? "Flanger (cubic)" : "Flanger (allpass)");
+            result->setProperty("nsPerSample", nanoseconds / blockSize);
+            result->setProperty("speedupOverPhaser", phaserNanoseconds / nanoseconds);
+            results.add(result.get());
+        }
+
+        return results;
+    }
+
+    // The multi-tap chorus at each number of taps, against as many juce::dsp::Chorus
+    // instances, which is what stacking them for an ensemble costs.
+    juce::var benchmarkChorus(double sampleRate, int blockSize, double seconds)
+    {
+        const float rate = 1.0f, depth = 0.5f, delay = 7.0f, feedback = 0.0f;
+        const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::Random random(1);
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            for (int i = 0; i < blockSize; ++i)
+                buffer.setSample(channel, i, random.nextFloat() - 0.5f);
+
+        juce::dsp::Chorus<float> juceChorus;
+        juceChorus.prepare({ sampleRate, (juce::uint32)blockSize, 2 });
+        juceChorus.setRate(rate);
+        juceChorus.setDepth(depth);
+        juceChorus.setCentreDelay(delay);
+        juceChorus.setFeedback(feedback);
+        juceChorus.setMix(0.5f);
+        const auto juceNanoseconds = measureBlocks(numBlocks, [&]
+        {
+            juce::dsp::AudioBlock<float> block(buffer);
+            juceChorus.process(juce::dsp::ProcessContextReplacing<float>(block));
+        });
+
+        juce::Array<juce::var> results;
+        double oneTapNanoseconds = 0.0;
+        for (int taps = 1; taps <= MultiTapChorus::maxTaps; ++taps)
+        {
+            MultiTapChorus chorus;
+            chorus.setParameters(rate, depth, delay, feedback);
+            chorus.setNumTaps(taps);
+            chorus.prepare(sampleRate);
+            const auto nanoseconds = measureBlocks(numBlocks, [&] { chorus.process(buffer, 0, blockSize); });
+            if (taps == 1)
+                oneTapNanoseconds = nanoseconds;
+
+            juce::DynamicObject::Ptr result = new juce::DynamicObject();
+            result->setProperty("taps", taps);
+            result->setProperty("nsPerSample", nanoseconds / blockSize);
+            result->setProperty("costRelativeToOneTap", nanoseconds / oneTapNanoseconds);
+            result->setProperty("stackedJuceChorusNsPerSample", taps * juceNanoseconds / blockSize);
+            results.add(result.get());
+        }
+
+        return results;
+    }
+
+    void runBenchmarks(const juce::ArgumentList& args)
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        const auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 0.25;
+        if (seconds <= 0.0)
+            juce::ConsoleApplication::fail("--seconds must be more than 0");
+
+        const double sampleRate = 48000.0;
+        juce::Array<juce::var> results;
+        for (int blockSize : { 32, 128, 512, 2048 })
+        {
+            const auto separate = benchmarkSeparate(sampleRate, blockSize, seconds);
+            const auto chain = benchmarkChain(sampleRate, blockSize, seconds, false);
+            const auto bypassed = benchmarkChain(sampleRate, blockSize, seconds, true);
+
+            juce::DynamicObject::Ptr result = new juce::DynamicObject();
+            result->setProperty("blockSize", blockSize);
+            result->setProperty("sampleRate", sampleRate);
+            result->setProperty("voices", numVoices);
+            result->setProperty("nsPerBlockSeparate", separate);
+            result->setProperty("nsPerBlockChain", chain);
+            result->setProperty("nsPerBlockAllBypassed", bypassed);
+            // Negative when the chain happens to be faster; either way it is noise-sized.
+            result->setProperty("overheadNsPerBlock", chain - separate);
+            result->setProperty("overheadFraction", chain / separate - 1.0);
+            results.add(result.get());
+        }
+
+        juce::DynamicObject::Ptr report = new juce::DynamicObject();
+        report->setProperty("cpu", juce::SystemStats::getCpuModel());
+        report->setProperty("repeats", numRepeats);
+        report->setProperty("secondsPerRun", seconds);
+        report->setProperty("chainOverhead", results);
+        report->setProperty("flanger", benchmarkFlanger(sampleRate, 512, seconds));
+        report->setProperty("chorus", benchmarkChorus(sampleRate, 512, seconds));
+
+        const auto json = juce::JSON::toString(report.get());
+        if (args.containsOption("--json"))
+        {
+            const auto file = args.getFileForOption("--json");
+            if (!file.replaceWithText(json))
+                juce::ConsoleApplication::fail("Couldn't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // The parameters' value tree expects a message manager, even with no window.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h", "Usage:", true);
+    app.addDefaultCommand({ "--bench",
+                            "--bench [--seconds 0.25] [--json results.json]",
+                            "Times the chain's processBlock against the three processors run separately, and prints JSON.",
+                            "Eight held notes through all three stages, at 48 kHz in blocks of 32 to 2048 samples,\n"
+                            "and the chain again with every stage bypassed. Also times the flanger against the Phaser\n"
+                            "it replaced, and the chorus at 1 to 8 taps against as many juce::dsp::Chorus instances,\n"
+                            "on stereo noise in blocks of 512. Each result is the best of a few runs.",
+                            runBenchmarks });
+
+    const int result = app.findAndRunCommand(argc, argv);
+
+    // Builds with REALTIME_SAFETY_CHECKS report anything processBlock shouldn't have done.
+    if (RealtimeSafety::getNumViolations() > 0)
+    {
+        RealtimeSafety::printViolations(std::cerr);
+        return result != 0 ? result : 1;
+    }
+    return result;
+}
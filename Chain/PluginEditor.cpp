@@ -0,0 +1,74 @@
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+#define margin 10
+#define controlHeight 30
+#define tabBarDepth 30
+
+//==============================================================================
+ChainAudioProcessorEditor::ChainAudioProcessorEditor(ChainAudioProcessor& p)
+    : AudioProcessorEditor(&p), audioProcessor(p), loadDisplay(p.loadMeter)
+{
+    tabs.setTabBarDepth(tabBarDepth);
+    const auto tabColour = getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId);
+    for (int stage = 0; stage < ChainAudioProcessor::numStages; ++stage)
+    {
+        const auto stageID = (ChainAudioProcessor::Stage)stage;
+        stageEditors[stage].reset(audioProcessor.getStage(stageID).createEditorIfNeeded());
+        if (stageEditors[stage] != nullptr)
+            tabs.addTab(ChainAudioProcessor::getStageName(stageID), tabColour, stageEditors[stage].get(), false);
+
+        bypassButtons[stage].setButtonText(juce::String("Bypass ") + ChainAudioProcessor::getStageName(stageID));
+        addAndMakeVisible(bypassButtons[stage]);
+        bypassAttachments[stage] = std::make_unique<ButtonAttachment>(audioProcessor.parameters,
+                                                                      ChainAudioProcessor::getBypassParameterID(stageID), bypassButtons[stage]);
+    }
+    addAndMakeVisible(tabs);
+
+    effectsOrder.addItem("Tremolo, then Chorus/Flanger", 1);
+    effectsOrder.addItem("Chorus/Flanger, then Tremolo", 2);
+    addAndMakeVisible(effectsOrder);
+    effectsOrderAttachment = std::make_unique<ComboBoxAttachment>(audioProcessor.parameters, "effectsOrder", effectsOrder);
+
+    addAndMakeVisible(loadDisplay);
+
+    // Wide and tall enough for the largest stage editor, the synth's.
+    int width = 400;
+    int height = 150;
+    for (auto& editor : stageEditors)
+        if (editor != nullptr)
+        {
+            width = juce::jmax(width, editor->getWidth());
+            height = juce::jmax(height, editor->getHeight());
+        }
+    setSize(width, height + tabBarDepth + 2 * controlHeight + 3 * margin);
+}
+
+ChainAudioProcessorEditor::~ChainAudioProcessorEditor()
+{
+}
+
+//==============================================================================
+void ChainAudioProcessorEditor::paint(juce::Graphics& g)
+{
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+    g.setColour(juce::Colours::white);
+    g.setFont(juce::FontOptions(15.0f));
+}
+
+void ChainAudioProcessorEditor::resized()
+{
+    auto area = getLocalBounds().reduced(margin, 0);
+    area.removeFromTop(margin);
+
+    auto controls = area.removeFromTop(controlHeight);
+    const int buttonWidth = controls.getWidth() / 5;
+    for (auto& button : bypassButtons)
+        button.setBounds(controls.removeFromLeft(buttonWidth));
+    effectsOrder.setBounds(controls);
+
+    area.removeFromTop(margin);
+    loadDisplay.setBounds(area.removeFromBottom(controlHeight).reduced(0, 5));
+    area.removeFromBottom(margin);
+    tabs.setBounds(area.withLeft(0).withRight(getWidth()));
+}
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    The chain's bypass switches and effect order above a tab for each
+    stage's own editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "../Shared/LoadMeterDisplay.h"
+
+//==============================================================================
+/**
+*/
+class ChainAudioProcessorEditor : public juce::AudioProcessorEditor
+{
+public:
+    ChainAudioProcessorEditor(ChainAudioProcessor&);
+    ~ChainAudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint(juce::Graphics&) override;
+    void resized() override;
+
+private:
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+
+    // This reference is provided as a quick way for your editor to
+    // access the processor object that created it.
+    ChainAudioProcessor& audioProcessor;
+
+    // Each stage's editor, declared before the tabs so they outlive them.
+    std::unique_ptr<juce::AudioProcessorEditor> stageEditors[ChainAudioProcessor::numStages];
+    juce::TabbedComponent tabs { juce::TabbedButtonBar::TabsAtTop };
+
+    juce::ToggleButton bypassButtons[ChainAudioProcessor::numStages];
+    juce::ComboBox effectsOrder;
+    LoadMeterDisplay loadDisplay;
+
+    // Declared after the controls, so they are destroyed first.
+    std::unique_ptr<ButtonAttachment> bypassAttachments[ChainAudioProcessor::numStages];
+    std::unique_ptr<ComboBoxAttachment> effectsOrderAttachment;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainAudioProcessorEditor)
+};
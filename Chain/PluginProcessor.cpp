@@ -0,0 +1,346 @@
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#include "../Shared/RealtimeSafety.h"
+
+namespace
+{
+    // Written first, so a later layout can still read this one.
+    const int stateVersion = 1;
+}
+
+//==============================================================================
+ChainAudioProcessor::ChainAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+    : AudioProcessor(BusesProperties()
+#if ! JucePlugin_IsMidiEffect
+#if ! JucePlugin_IsSynth
+        .withInput("Input", juce::AudioChannelSet::stereo(), true)
+#endif
+        .withOutput("Output", juce::AudioChannelSet::stereo(), true)
+#endif
+    )
+#endif
+    , parameters(*this, nullptr, "Chain", createParameterLayout())
+{
+    for (int stage = 0; stage < numStages; ++stage)
+        bypass[stage] = parameters.getRawParameterValue(getBypassParameterID((Stage)stage));
+    effectsSwapped = parameters.getRawParameterValue("effectsOrder");
+
+    for (int stage = 0; stage < numStages; ++stage)
+        wasBypassed[stage] = isBypassed((Stage)stage);
+}
+
+ChainAudioProcessor::~ChainAudioProcessor()
+{
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout ChainAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    for (int stage = 0; stage < numStages; ++stage)
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { getBypassParameterID((Stage)stage), 1 },
+                                                              juce::String("Bypass ") + getStageName((Stage)stage), false));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "effectsOrder", 1 }, "Effects Order",
+                                                            juce::StringArray { "Tremolo, then Chorus/Flanger", "Chorus/Flanger, then Tremolo" }, 0));
+    return layout;
+}
+
+const char* ChainAudioProcessor::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+    case SynthStage:            return "Synth";
+    case TremoloStage:          return "Tremolo";
+    case ChorusFlangerStage:    return "Chorus/Flanger";
+    case numStages:             break;
+    }
+    return "";
+}
+
+juce::String ChainAudioProcessor::getBypassParameterID(Stage stage)
+{
+    switch (stage)
+    {
+    case SynthStage:            return "synthBypass";
+    case TremoloStage:          return "tremoloBypass";
+    case ChorusFlangerStage:    return "chorusFlangerBypass";
+    case numStages:             break;
+    }
+    return {};
+}
+
+void ChainAudioProcessor::getStageOrder(Stage (&order)[numStages]) const
+{
+    const bool swapped = effectsSwapped->load(std::memory_order_relaxed) >= 0.5f;
+    order[0] = SynthStage;
+    order[1] = swapped ? ChorusFlangerStage : TremoloStage;
+    order[2] = swapped ? TremoloStage : ChorusFlangerStage;
+}
+
+juce::AudioProcessor& ChainAudioProcessor::getStage(Stage stage)
+{
+    switch (stage)
+    {
+    case TremoloStage:          return tremolo;
+    case ChorusFlangerStage:    return chorusFlanger;
+    case SynthStage:
+    case numStages:             break;
+    }
+    return synth;
+}
+
+void ChainAudioProcessor::setParameterValue(const juce::String& parameterID, float value)
+{
+    if (auto* parameter = parameters.getParameter(parameterID))
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+//==============================================================================
+const juce::String ChainAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool ChainAudioProcessor::acceptsMidi() const
+{
+#if JucePlugin_WantsMidiInput
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ChainAudioProcessor::producesMidi() const
+{
+#if JucePlugin_ProducesMidiOutput
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ChainAudioProcessor::isMidiEffect() const
+{
+#if JucePlugin_IsMidiEffect
+    return true;
+#else
+    return false;
+#endif
+}
+
+double ChainAudioProcessor::getTailLengthSeconds() const
+{
+    // The stages run one after another, so their tails add up.
+    double tail = 0.0;
+    if (!isBypassed(SynthStage))
+        tail += synth.getTailLengthSeconds();
+    if (!isBypassed(TremoloStage))
+        tail += tremolo.getTailLengthSeconds();
+    if (!isBypassed(ChorusFlangerStage))
+        tail += chorusFlanger.getTailLengthSeconds();
+    return tail;
+}
+
+int ChainAudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int ChainAudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void ChainAudioProcessor::setCurrentProgram(int index)
+{
+}
+
+const juce::String ChainAudioProcessor::getProgramName(int index)
+{
+    return {};
+}
+
+void ChainAudioProcessor::changeProgramName(int index, const juce::String& newName)
+{
+}
+
+//==============================================================================
+void ChainAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    // Every stage is prepared, bypassed or not, so switching one back in never allocates.
+    const int numChannels = getTotalNumOutputChannels();
+    synth.setPlayConfigDetails(0, numChannels, sampleRate, samplesPerBlock);
+    tremolo.setPlayConfigDetails(numChannels, numChannels, sampleRate, samplesPerBlock);
+    chorusFlanger.setPlayConfigDetails(numChannels, numChannels, sampleRate, samplesPerBlock);
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        getStage((Stage)stage).prepareToPlay(sampleRate, samplesPerBlock);
+        wasBypassed[stage] = isBypassed((Stage)stage);
+    }
+
+    dryBuffer.setSize(numChannels, samplesPerBlock);
+    loadMeter.prepare(sampleRate);
+}
+
+void ChainAudioProcessor::releaseResources()
+{
+    for (int stage = 0; stage < numStages; ++stage)
+        getStage((Stage)stage).releaseResources();
+}
+
+void ChainAudioProcessor::reset()
+{
+    for (int stage = 0; stage < numStages; ++stage)
+        getStage((Stage)stage).reset();
+}
+
+void ChainAudioProcessor::setNonRealtime(bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime(isNonRealtime);
+    for (int stage = 0; stage < numStages; ++stage)
+        getStage((Stage)stage).setNonRealtime(isNonRealtime);
+}
+
+void ChainAudioProcessor::setPlayHead(juce::AudioPlayHead* newPlayHead)
+{
+    AudioProcessor::setPlayHead(newPlayHead);
+    for (int stage = 0; stage < numStages; ++stage)
+        getStage((Stage)stage).setPlayHead(newPlayHead);
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool ChainAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+#if JucePlugin_IsMidiEffect
+    juce::ignoreUnused(layouts);
+    return true;
+#else
+    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
+        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+        return false;
+
+#if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+#endif
+
+    return true;
+#endif
+}
+#endif
+
+void ChainAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    const RealtimeSafety::ScopedCheck realtimeCheck;
+    const LoadMeter::ScopedTimer loadTimer(loadMeter, buffer.getNumSamples());
+    juce::ScopedNoDenormals noDenormals;
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin(buffer.getNumChannels(), dryBuffer.getNumChannels());
+
+    Stage order[numStages];
+    getStageOrder(order);
+
+    for (const auto stage : order)
+    {
+        auto& processor = getStage(stage);
+        const bool bypassed = isBypassed(stage);
+        const bool switched = bypassed != wasBypassed[stage];
+        wasBypassed[stage] = bypassed;
+
+        // Note-offs will be missed while the synth is out, so nothing is left holding.
+        if (switched && bypassed && stage == SynthStage)
+            synth.releaseAllNotes();
+
+        // Hosts may exceed the block size they announced; such a block switches without the fade.
+        const bool fade = switched && numSamples <= dryBuffer.getNumSamples();
+        if (bypassed && !fade)
+        {
+            // Without the synth to write over it, the host's buffer may hold anything.
+            if (stage == SynthStage)
+                buffer.clear();
+            continue;
+        }
+        if (!fade)
+        {
+            processor.processBlock(buffer, midiMessages);
+            continue;
+        }
+
+        // The synth's input is silence; an effect's is what the stages before it left.
+        if (stage != SynthStage)
+            for (int channel = 0; channel < numChannels; ++channel)
+                dryBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+        processor.processBlock(buffer, midiMessages);
+
+        const float startGain = bypassed ? 1.0f : 0.0f;
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            buffer.applyGainRamp(channel, 0, numSamples, startGain, 1.0f - startGain);
+        if (stage != SynthStage)
+            for (int channel = 0; channel < numChannels; ++channel)
+                buffer.addFromWithRamp(channel, 0, dryBuffer.getReadPointer(channel), numSamples, 1.0f - startGain, startGain);
+    }
+}
+
+//==============================================================================
+bool ChainAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* ChainAudioProcessor::createEditor()
+{
+    return new ChainAudioProcessorEditor(*this);
+}
+
+//==============================================================================
+void ChainAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    // The chain's own settings, then each stage's state in Stage order, prefixed with its size.
+    juce::MemoryOutputStream stream(destData, true);
+    stream.writeInt(stateVersion);
+    for (int stage = 0; stage < numStages; ++stage)
+        stream.writeBool(isBypassed((Stage)stage));
+    stream.writeBool(effectsSwapped->load() >= 0.5f);
+
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        juce::MemoryBlock stageState;
+        getStage((Stage)stage).getStateInformation(stageState);
+        stream.writeInt((int)stageState.getSize());
+        stream.write(stageState.getData(), stageState.getSize());
+    }
+}
+
+void ChainAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    juce::MemoryInputStream stream(data, (size_t)juce::jmax(0, sizeInBytes), false);
+    if (stream.getNumBytesRemaining() < (juce::int64)(sizeof(int) + numStages + 1) || stream.readInt() != stateVersion)
+        return;
+
+    for (int stage = 0; stage < numStages; ++stage)
+        setParameterValue(getBypassParameterID((Stage)stage), stream.readBool() ? 1.0f : 0.0f);
+    setParameterValue("effectsOrder", stream.readBool() ? 1.0f : 0.0f);
+
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        if (stream.getNumBytesRemaining() < (juce::int64)sizeof(int))
+            return;
+        const int size = stream.readInt();
+        if (size < 0 || size > stream.getNumBytesRemaining())
+            return;
+
+        // An empty state is what a stage with nothing to save wrote; leave it as it is.
+        if (size > 0)
+            getStage((Stage)stage).setStateInformation(static_cast<const char*>(data) + stream.getPosition(), size);
+        stream.skipNextBytes(size);
+    }
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new ChainAudioProcessor();
+}
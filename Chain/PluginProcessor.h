@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    The Synth, Tremolo and Chorus/Flanger processors run as stages of one
+    plugin, in place on the host's buffer, with a bypass per stage.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../ChorusFlanger/PluginProcessor.h"
+#include "../Shared/LoadMeter.h"
+#include "../Synth/PluginProcessor.h"
+#include "../Tremolo/PluginProcessor.h"
+
+//==============================================================================
+/**
+*/
+class ChainAudioProcessor : public juce::AudioProcessor
+{
+public:
+    enum Stage
+    {
+        SynthStage,
+        TremoloStage,
+        ChorusFlangerStage,
+        numStages
+    };
+
+    //==============================================================================
+    ChainAudioProcessor();
+    ~ChainAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+    void reset() override;
+    void setNonRealtime(bool isNonRealtime) noexcept override;
+    void setPlayHead(juce::AudioPlayHead* newPlayHead) override;
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
+#endif
+
+    void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram(int index) override;
+    const juce::String getProgramName(int index) override;
+    void changeProgramName(int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    //==============================================================================
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    static const char* getStageName(Stage stage);
+    static juce::String getBypassParameterID(Stage stage);
+
+    // The bypass switches and the order of the effects; each stage keeps its own parameters.
+    juce::AudioProcessorValueTreeState parameters;
+
+    // The synth writes over the buffer rather than adding to it, so it always runs first;
+    // only the order of the two effects after it can change.
+    void getStageOrder(Stage (&order)[numStages]) const;
+    bool isBypassed(Stage stage) const { return bypass[stage]->load(std::memory_order_relaxed) >= 0.5f; }
+    juce::AudioProcessor& getStage(Stage stage);
+
+    // The whole chain's DSP load; each stage's own meter still times just that stage.
+    LoadMeter loadMeter;
+
+    SynthAudioProcessor synth;
+    TremoloAudioProcessor tremolo;
+    ChorusFlangerAudioProcessor chorusFlanger;
+
+private:
+    void setParameterValue(const juce::String& parameterID, float value);
+
+    std::atomic<float>* bypass[numStages];
+    std::atomic<float>* effectsSwapped;
+
+    // A bypass switched since the last block fades over one block instead of clicking;
+    // the stage's input is kept here to fade against.
+    bool wasBypassed[numStages] = {};
+    juce::AudioBuffer<float> dryBuffer;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChainAudioProcessor)
+};
@@ -0,0 +1,169 @@
+#include "Flanger.h"
+#include "../Shared/FastMath.h"
+
+void Flanger::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+
+    // The longest sweep, plus the frames either side that cubic interpolation reads.
+    maxDelay = (float)(2.0 * maxDelayMilliseconds * 0.001 * sampleRate);
+    const int lineSize = juce::nextPowerOfTwo((int)std::ceil(maxDelay) + 4);
+    line.assign((size_t)lineSize, FloatVec::expand(0.0f));
+    lineMask = lineSize - 1;
+    frames.assign((size_t)juce::jmax(1, maximumBlockSize), FloatVec::expand(0.0f));
+
+    lfoPhase = 0.0;
+    reset();
+}
+
+void Flanger::reset()
+{
+    for (auto& frame : line)
+        frame = FloatVec::expand(0.0f);
+    writeIndex = 0;
+    allpassState = FloatVec::expand(0.0f);
+
+    delay = getTargetDelay();
+    delayStep = 0.0f;
+    samplesUntilUpdate = 0;
+}
+
+void Flanger::setParameters(float newRate, float newDepth, float delayMilliseconds, float newFeedback)
+{
+    rate = juce::jmax(0.0f, newRate);
+    depth = juce::jlimit(0.0f, 1.0f, newDepth);
+    centreMilliseconds = juce::jlimit(minDelayMilliseconds, maxDelayMilliseconds, delayMilliseconds);
+    feedback = FloatVec::expand(juce::jlimit(-maxFeedback, maxFeedback, newFeedback));
+}
+
+float Flanger::getTargetDelay() const
+{
+    const auto centre = centreMilliseconds * 0.001f * (float)sampleRate;
+    const auto target = centre * (1.0f + depth * FastMath::sin((float)lfoPhase));
+    return juce::jlimit(minDelaySamples, juce::jmax(minDelaySamples, maxDelay), target);
+}
+
+void Flanger::advanceControl()
+{
+    lfoPhase += rate / sampleRate * controlInterval;
+    lfoPhase -= std::floor(lfoPhase);
+
+    delayStep = (getTargetDelay() - delay) / (float)controlInterval;
+    samplesUntilUpdate = controlInterval;
+}
+
+void Flanger::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+    if (line.empty() || numChannels == 0)
+        return;
+
+    // The frames' lanes, seen as floats, to interleave into and out of.
+    auto* const lanes = reinterpret_cast<float*>(frames.data());
+
+    for (int start = 0; start < numSamples;)
+    {
+        const int numFrames = juce::jmin(numSamples - start, (int)frames.size());
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* samples = buffer.getReadPointer(channel, startSample + start);
+            for (int i = 0; i < numFrames; ++i)
+                lanes[i * maxChannels + channel] = samples[i];
+        }
+
+        switch (interpolation)
+        {
+        case LinearInterpolation:   processFrames<LinearInterpolation>(frames.data(), numFrames); break;
+        case AllpassInterpolation:  processFrames<AllpassInterpolation>(frames.data(), numFrames); break;
+        case CubicInterpolation:
+        default:                    processFrames<CubicInterpolation>(frames.data(), numFrames); break;
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = buffer.getWritePointer(channel, startSample + start);
+            for (int i = 0; i < numFrames; ++i)
+                samples[i] = lanes[i * maxChannels + channel];
+        }
+
+        start += numFrames;
+    }
+}
+
+template <Flanger::Interpolation mode>
+void Flanger::processFrames(FloatVec* frameData, int numFrames)
+{
+    const auto half = FloatVec::expand(0.5f);
+    const auto feedbackGain = feedback;
+    auto* const lineData = line.data();
+    const int mask = lineMask;
+
+    for (int start = 0; start < numFrames;)
+    {
+        if (samplesUntilUpdate == 0)
+            advanceControl();
+        const int numInInterval = juce::jmin(numFrames - start, samplesUntilUpdate);
+        samplesUntilUpdate -= numInInterval;
+
+        // Locals, since the stores to the line could otherwise alias the members.
+        int index = writeIndex;
+        float currentDelay = delay;
+        const float step = delayStep;
+        auto state = allpassState;
+        auto tap = [lineData, mask, &index](int framesAgo) { return lineData[(index - framesAgo) & mask]; };
+
+        for (int i = start; i < start + numInInterval; ++i)
+        {
+            // The integer part picks the frames and the fraction weights them; both are the
+            // same for every lane.
+            int whole = (int)currentDelay;
+            float fraction = currentDelay - (float)whole;
+            currentDelay += step;
+
+            FloatVec wet;
+            if (mode == LinearInterpolation)
+            {
+                const auto x0 = tap(whole);
+                wet = FloatVec::multiplyAdd(x0, FloatVec::expand(fraction), tap(whole + 1) - x0);
+            }
+            else if (mode == CubicInterpolation)
+            {
+                // Catmull-Rom through the frames either side of the read position.
+                const auto xm1 = tap(whole - 1);
+                const auto x0 = tap(whole);
+                const auto x1 = tap(whole + 1);
+                const auto x2 = tap(whole + 2);
+                const auto c1 = half * (x1 - xm1);
+                const auto c2 = xm1 - FloatVec::expand(2.5f) * x0 + FloatVec::expand(2.0f) * x1 - half * x2;
+                const auto c3 = half * (x2 - xm1) + FloatVec::expand(1.5f) * (x0 - x1);
+                const auto t = FloatVec::expand(fraction);
+                wet = FloatVec::multiplyAdd(x0, t, FloatVec::multiplyAdd(c1, t, FloatVec::multiplyAdd(c2, t, c3)));
+            }
+            else
+            {
+                // A first-order allpass for the fraction: flat in level, unlike the others,
+                // so the highs don't dull as the tap moves. Fractions near 0 put its pole
+                // near -1, so they take a frame from the integer part instead.
+                if (fraction < 0.1f)
+                {
+                    --whole;
+                    fraction += 1.0f;
+                }
+                const auto coefficient = FloatVec::expand((1.0f - fraction) / (1.0f + fraction));
+                wet = FloatVec::multiplyAdd(tap(whole + 1), coefficient, tap(whole) - state);
+                state = wet;
+            }
+
+            const auto dry = frameData[i];
+            lineData[index] = FloatVec::multiplyAdd(dry, feedbackGain, wet);
+            index = (index + 1) & mask;
+            frameData[i] = half * (dry + wet);
+        }
+
+        writeIndex = index;
+        delay = currentDelay;
+        allpassState = state;
+        start += numInInterval;
+    }
+}
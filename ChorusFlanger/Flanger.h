@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    Flanger: a short feedback delay line whose read tap is swept by a sine
+    LFO, mixed back with its input so the comb's notches move.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// One SIMD register holds a frame, a sample of every channel, so every channel is
+// processed in the same pass. All channels share the LFO, as the Phaser this replaces
+// did, so each frame needs only one read position. The delay is recomputed every
+// controlInterval samples and ramps linearly in between, on the sample clock rather
+// than the host's blocks.
+class Flanger
+{
+public:
+    using FloatVec = juce::dsp::SIMDRegister<float>;
+
+    enum Interpolation
+    {
+        LinearInterpolation = 1,
+        CubicInterpolation = 2,
+        AllpassInterpolation = 3
+    };
+
+    static constexpr int maxChannels = (int)FloatVec::SIMDNumElements;
+    static constexpr int controlInterval = 32;
+    // The centre delay's range; the sweep reaches up to twice it.
+    static constexpr float minDelayMilliseconds = 0.5f;
+    static constexpr float maxDelayMilliseconds = 25.0f;
+    // Short of 1, so the comb can't ring forever.
+    static constexpr float maxFeedback = 0.95f;
+
+    Flanger() {}
+    ~Flanger() {}
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset();
+
+    // rate in Hz; the delay sweeps between delay * (1 - depth) and delay * (1 + depth).
+    // feedback's sign is its polarity: negative feedback moves the comb's peaks onto
+    // its notches.
+    void setParameters(float rate, float depth, float delayMilliseconds, float feedback);
+    void setInterpolation(Interpolation newInterpolation) { interpolation = newInterpolation; }
+
+    // Up to maxChannels channels, in place.
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+private:
+    // Cubic reads one frame newer than the integer delay, so it must already be written.
+    static constexpr float minDelaySamples = 2.0f;
+
+    template <Interpolation>
+    void processFrames(FloatVec* frameData, int numFrames);
+    void advanceControl();
+    float getTargetDelay() const;
+
+    double sampleRate = 44100.0;
+    float rate = 0.5f;
+    float depth = 0.6f;
+    float centreMilliseconds = 2.0f;
+    float maxDelay = 0.0f;          // samples, what the line can hold
+    FloatVec feedback = FloatVec::expand(0.0f);
+    Interpolation interpolation = CubicInterpolation;
+
+    double lfoPhase = 0.0;          // cycles, at the end of the current interval
+    int samplesUntilUpdate = 0;
+    float delay = 0.0f;             // samples, at the next frame
+    float delayStep = 0.0f;
+
+    std::vector<FloatVec> line;
+    int lineMask = 0;
+    int writeIndex = 0;
+    FloatVec allpassState = FloatVec::expand(0.0f);
+
+    // The block as frames, so the pass over it loads and stores whole registers.
+    std::vector<FloatVec> frames;
+};
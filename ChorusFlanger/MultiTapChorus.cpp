@@ -0,0 +1,168 @@
+#include "MultiTapChorus.h"
+#include "../Shared/FastMath.h"
+
+void MultiTapChorus::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    // The longest centre delay and sweep, plus the older sample a read interpolates towards.
+    maxDelay = (float)((maxDelayMilliseconds + maxSweepMilliseconds) * 0.001 * sampleRate);
+    const int lineSize = juce::nextPowerOfTwo((int)std::ceil(maxDelay) + 2);
+    lines.assign((size_t)(maxChannels * lineSize), 0.0f);
+    lineMask = lineSize - 1;
+
+    lfoPhase = 0.0;
+    setNumTaps(numTaps);
+    reset();
+}
+
+void MultiTapChorus::reset()
+{
+    std::fill(lines.begin(), lines.end(), 0.0f);
+    writeIndex = 0;
+
+    // Straight to the LFO's current delays, rather than ramping from wherever they were.
+    advanceControl();
+    for (int channel = 0; channel < maxChannels; ++channel)
+        for (int tap = 0; tap < numTapRegisters * laneWidth; ++tap)
+        {
+            delays[channel][tap] += delaySteps[channel][tap] * controlInterval;
+            delaySteps[channel][tap] = 0.0f;
+        }
+    samplesUntilUpdate = 0;
+}
+
+void MultiTapChorus::setParameters(float newRate, float newDepth, float delayMilliseconds, float newFeedback)
+{
+    rate = juce::jmax(0.0f, newRate);
+    depth = juce::jlimit(0.0f, 1.0f, newDepth);
+    centreMilliseconds = juce::jlimit(minDelayMilliseconds, maxDelayMilliseconds, delayMilliseconds);
+    feedback = juce::jlimit(-maxFeedback, maxFeedback, newFeedback);
+}
+
+void MultiTapChorus::setNumTaps(int newNumTaps)
+{
+    numTaps = juce::jlimit(1, maxTaps, newNumTaps);
+    numActiveRegisters = (numTaps + laneWidth - 1) / laneWidth;
+    for (int tap = 0; tap < numTapRegisters * laneWidth; ++tap)
+        tapGains[tap] = tap < numTaps ? 1.0f / (float)numTaps : 0.0f;
+}
+
+void MultiTapChorus::advanceControl()
+{
+    lfoPhase += rate / sampleRate * controlInterval;
+    lfoPhase -= std::floor(lfoPhase);
+
+    const auto samplesPerMillisecond = (float)(0.001 * sampleRate);
+    const auto centre = FloatVec::expand(centreMilliseconds * samplesPerMillisecond);
+    const auto sweep = FloatVec::expand(depth * maxSweepMilliseconds * samplesPerMillisecond);
+    const auto lowest = FloatVec::expand(1.0f);
+    const auto highest = FloatVec::expand(maxDelay);
+    const auto perSample = FloatVec::expand(1.0f / (float)controlInterval);
+
+    alignas(FloatVec::SIMDRegisterSize) float tapOffsets[laneWidth];
+    for (int channel = 0; channel < maxChannels; ++channel)
+        for (int r = 0; r < numTapRegisters; ++r)
+        {
+            for (int lane = 0; lane < laneWidth; ++lane)
+                tapOffsets[lane] = (float)(r * laneWidth + lane) / (float)numTaps;
+
+            // The channels' LFOs in quadrature, each tap an equal share of a cycle on.
+            const auto phase = FloatVec::expand((float)lfoPhase + 0.25f * (float)channel) + FloatVec::fromRawArray(tapOffsets);
+            auto target = FloatVec::multiplyAdd(centre, sweep, FastMath::sin(phase));
+            target = FloatVec::min(FloatVec::max(target, lowest), highest);
+
+            auto* channelDelays = delays[channel] + r * laneWidth;
+            ((target - FloatVec::fromRawArray(channelDelays)) * perSample).copyToRawArray(delaySteps[channel] + r * laneWidth);
+        }
+
+    samplesUntilUpdate = controlInterval;
+}
+
+void MultiTapChorus::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+    if (lines.empty())
+        return;
+
+    for (int start = 0; start < numSamples;)
+    {
+        if (samplesUntilUpdate == 0)
+            advanceControl();
+        const int length = juce::jmin(numSamples - start, samplesUntilUpdate);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            processChannel(buffer.getWritePointer(channel, startSample + start), length, channel);
+
+        // Without a second channel, its taps still move, so they are in place if one appears.
+        for (int channel = numChannels; channel < maxChannels; ++channel)
+            for (int tap = 0; tap < numTapRegisters * laneWidth; ++tap)
+                delays[channel][tap] += delaySteps[channel][tap] * (float)length;
+
+        writeIndex = (writeIndex + length) & lineMask;
+        samplesUntilUpdate -= length;
+        start += length;
+    }
+}
+
+void MultiTapChorus::processChannel(float* samples, int numSamples, int channel)
+{
+    float* const line = lines.data() + (size_t)channel * (size_t)(lineMask + 1);
+    const int mask = lineMask;
+
+    FloatVec delay[numTapRegisters], step[numTapRegisters], gain[numTapRegisters];
+    for (int r = 0; r < numActiveRegisters; ++r)
+    {
+        delay[r] = FloatVec::fromRawArray(delays[channel] + r * laneWidth);
+        step[r] = FloatVec::fromRawArray(delaySteps[channel] + r * laneWidth);
+        gain[r] = FloatVec::fromRawArray(tapGains + r * laneWidth);
+    }
+
+    alignas(FloatVec::SIMDRegisterSize) float positions[laneWidth];
+    alignas(FloatVec::SIMDRegisterSize) float newer[laneWidth];
+    alignas(FloatVec::SIMDRegisterSize) float older[laneWidth];
+
+    int index = writeIndex;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto wet = FloatVec::expand(0.0f);
+        for (int r = 0; r < numActiveRegisters; ++r)
+        {
+            // Only the fetches are per tap; the unused lanes read real samples at gain 0.
+            delay[r].copyToRawArray(positions);
+            for (int lane = 0; lane < laneWidth; ++lane)
+            {
+                const int read = index - (int)positions[lane];
+                newer[lane] = line[read & mask];
+                older[lane] = line[(read - 1) & mask];
+            }
+
+            const auto fraction = delay[r] - FloatVec::truncate(delay[r]);
+            const auto x0 = FloatVec::fromRawArray(newer);
+            const auto tapSamples = FloatVec::multiplyAdd(x0, fraction, FloatVec::fromRawArray(older) - x0);
+            wet = FloatVec::multiplyAdd(wet, gain[r], tapSamples);
+            delay[r] += step[r];
+        }
+
+        const float dry = samples[i];
+        const float mixed = wet.sum();
+        line[index] = dry + feedback * mixed;
+        index = (index + 1) & mask;
+        samples[i] = 0.5f * (dry + mixed);
+    }
+
+    // The registers not in use still follow their LFOs.
+    for (int r = 0; r < numTapRegisters; ++r)
+    {
+        if (r < numActiveRegisters)
+        {
+            delay[r].copyToRawArray(delays[channel] + r * laneWidth);
+        }
+        else
+        {
+            auto* tapDelays = delays[channel] + r * laneWidth;
+            (FloatVec::fromRawArray(tapDelays) + FloatVec::fromRawArray(delaySteps[channel] + r * laneWidth) * (float)numSamples)
+                .copyToRawArray(tapDelays);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    Chorus: up to maxTaps modulated taps per channel, all read from the
+    channel's one delay line and mixed back with its input.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Each tap's LFO is offset by an equal share of a cycle from the next, and each channel's
+// LFOs run a quarter cycle from the other channel's, so the taps never line up. The taps'
+// delays sit in SIMD registers a register of taps at a time: only fetching the two
+// samples either side of each read position is per tap, and the interpolation, the
+// weighting and the LFO are shared. The delays are recomputed every controlInterval
+// samples and ramp linearly in between, on the sample clock rather than the host's blocks.
+class MultiTapChorus
+{
+public:
+    using FloatVec = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int maxTaps = 8;
+    static constexpr int maxChannels = 2;
+    static constexpr int controlInterval = 32;
+    static constexpr float minDelayMilliseconds = 1.0f;
+    static constexpr float maxDelayMilliseconds = 25.0f;
+    // How far either side of the centre delay a full-depth sweep reaches.
+    static constexpr float maxSweepMilliseconds = 2.0f;
+    static constexpr float maxFeedback = 0.95f;
+
+    MultiTapChorus() {}
+    ~MultiTapChorus() {}
+
+    void prepare(double sampleRate);
+    void reset();
+
+    // rate in Hz; depth 0-1 scales the sweep; feedback is of the taps' mix.
+    void setParameters(float rate, float depth, float delayMilliseconds, float feedback);
+    void setNumTaps(int numTaps);
+    int getNumTaps() const { return numTaps; }
+
+    // Up to maxChannels channels, in place.
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+private:
+    static constexpr int laneWidth = (int)FloatVec::SIMDNumElements;
+    static constexpr int numTapRegisters = (maxTaps + laneWidth - 1) / laneWidth;
+
+    void advanceControl();
+    void processChannel(float* samples, int numSamples, int channel);
+
+    double sampleRate = 44100.0;
+    float rate = 5.0f;
+    float depth = 0.6f;
+    float centreMilliseconds = 15.0f;
+    float feedback = 0.0f;
+    int numTaps = 1;
+    int numActiveRegisters = 1;
+
+    double lfoPhase = 0.0;          // cycles, at the end of the current interval
+    int samplesUntilUpdate = 0;
+
+    // In samples, at the next frame, and their change per frame; all maxTaps lanes are
+    // kept moving so a tap switched on starts from where its LFO is.
+    alignas(FloatVec::SIMDRegisterSize) float delays[maxChannels][numTapRegisters * laneWidth] = {};
+    alignas(FloatVec::SIMDRegisterSize) float delaySteps[maxChannels][numTapRegisters * laneWidth] = {};
+    // 1 / numTaps for the taps in use, 0 for the rest.
+    alignas(FloatVec::SIMDRegisterSize) float tapGains[numTapRegisters * laneWidth] = {};
+    float maxDelay = 1.0f;          // samples, what the line can hold
+
+    std::vector<float> lines;       // maxChannels lines of lineMask + 1 samples
+    int lineMask = 0;
+    int writeIndex = 0;             // the same for every channel
+};
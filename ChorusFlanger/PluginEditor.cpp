@@ -11,45 +11,51 @@
 
 //==============================================================================
 ChorusFlangerAudioProcessorEditor::ChorusFlangerAudioProcessorEditor (ChorusFlangerAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p), loadDisplay (p.loadMeter)
 {
-    setSize(400, 300);
+    setSize(490, 300);
 
     addAndMakeVisible(modeSelector);
-    modeSelector.addItem("Chorus", 1);
-    modeSelector.addItem("Flanger", 2);
-    modeSelector.setSelectedId(1, juce::dontSendNotification);
-
-    setupKnob(rateKnob, rateLabel, "Rate", 0.1f, 20.0f, 5.0f);
-    setupKnob(depthKnob, depthLabel, "Depth", 0.0f, 1.0f, 0.6f);
-    setupKnob(delayKnob, delayLabel, "Delay", 1.0f, 25.0f, 15.0f);
-    setupKnob(feedbackKnob, feedbackLabel, "Feedback", 0.0f, 1.0f, 0.05f);
-
-
-	modeSelector.addListener(this);
-    rateKnob.addListener(this);
-    depthKnob.addListener(this);
-    delayKnob.addListener(this);
-    feedbackKnob.addListener(this);
-
-    //comboBoxChanged(&modeSelector);
+    modeSelector.addItemList(juce::StringArray { "Chorus", "Flanger" }, 1);
+    modeSelector.onChange = [this] { updateModeControls(); };
+
+    setupKnob(rateKnob, rateLabel, "Rate");
+    setupKnob(depthKnob, depthLabel, "Depth");
+    setupKnob(delayKnob, delayLabel, "Delay");
+    setupKnob(flangerDelayKnob, flangerDelayLabel, "Delay");
+    setupKnob(feedbackKnob, feedbackLabel, "Feedback");
+    setupKnob(tapsKnob, tapsLabel, "Voices");
+
+    // The flanger's own settings; the chorus ignores them.
+    addAndMakeVisible(interpolationSelector);
+    interpolationSelector.addItemList(juce::StringArray { "Linear", "Cubic", "Allpass" }, 1);
+    addAndMakeVisible(invertButton);
+
+    addAndMakeVisible(loadDisplay);
+
+    // The attachments take the ranges from the parameters and open on their values.
+    auto& parameters = audioProcessor.parameters;
+    modeAttachment = std::make_unique<ComboBoxAttachment>(parameters, "mode", modeSelector);
+    rateAttachment = std::make_unique<SliderAttachment>(parameters, "rate", rateKnob);
+    depthAttachment = std::make_unique<SliderAttachment>(parameters, "depth", depthKnob);
+    delayAttachment = std::make_unique<SliderAttachment>(parameters, "delay", delayKnob);
+    flangerDelayAttachment = std::make_unique<SliderAttachment>(parameters, "flangerDelay", flangerDelayKnob);
+    feedbackAttachment = std::make_unique<SliderAttachment>(parameters, "feedback", feedbackKnob);
+    tapsAttachment = std::make_unique<SliderAttachment>(parameters, "chorusTaps", tapsKnob);
+    interpolationAttachment = std::make_unique<ComboBoxAttachment>(parameters, "interpolation", interpolationSelector);
+    invertAttachment = std::make_unique<ButtonAttachment>(parameters, "invertFeedback", invertButton);
+
+    updateModeControls();
 }
 ChorusFlangerAudioProcessorEditor::~ChorusFlangerAudioProcessorEditor()
 {
-	modeSelector.removeListener(this);
-    rateKnob.removeListener(this);
-    depthKnob.removeListener(this);
-    delayKnob.removeListener(this);
-    feedbackKnob.removeListener(this);
 }
 
-void ChorusFlangerAudioProcessorEditor::setupKnob(juce::Slider& knob, juce::Label& label, const juce::String& name, float min, float max, float defaultVal)
+void ChorusFlangerAudioProcessorEditor::setupKnob(juce::Slider& knob, juce::Label& label, const juce::String& name)
 {
     addAndMakeVisible(knob);
     knob.setSliderStyle(juce::Slider::Rotary);
     knob.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
-    knob.setRange(min, max, 0.01f);
-    knob.setValue(defaultVal);
 
     addAndMakeVisible(label);
     label.setText(name, juce::dontSendNotification);
@@ -57,41 +63,17 @@ void ChorusFlangerAudioProcessorEditor::setupKnob(juce::Slider& knob, juce::Labe
     label.setJustificationType(juce::Justification::centred);
 }
 
-void ChorusFlangerAudioProcessorEditor::comboBoxChanged(juce::ComboBox* comboBox)
+void ChorusFlangerAudioProcessorEditor::updateModeControls()
 {
-    bool isChorus = (modeSelector.getSelectedId() == 1);
-    audioProcessor.isChorus = isChorus;
-
-    float oldRate = rateKnob.getValue();
-    float oldDelay = delayKnob.getValue();
-    float oldFeedback = feedbackKnob.getValue();
-    rateKnob.setRange(isChorus ? 0.1f : 0.2f, 20.0f, 0.01f);
-    depthKnob.setSkewFactor(isChorus ? 1.0f : 1.2f);
-    delayKnob.setRange(isChorus ? 1.0f : 0.5f, isChorus ? 25.0f : 5.0f, 0.01f);
-	feedbackKnob.setValue(isChorus ? oldFeedback / 3 : oldFeedback * 3, juce::dontSendNotification);
-
-    
-    rateKnob.setValue(isChorus ? juce::jmap(oldRate, 0.2f, 20.0f, 0.1f, 20.0f) : juce::jmap(oldRate, 0.1f, 20.0f, 0.2f, 20.0f), juce::dontSendNotification);
-
-    delayKnob.setValue(isChorus ? juce::jmap(oldDelay, 0.5f, 5.0f, 1.0f, 25.0f) : juce::jmap(oldDelay, 1.0f, 25.0f, 0.5f, 5.0f), juce::dontSendNotification);
-
-    sliderValueChanged(&rateKnob);
-	sliderValueChanged(&depthKnob);
-	sliderValueChanged(&delayKnob);
-	sliderValueChanged(&feedbackKnob);
+    const bool isChorus = modeSelector.getSelectedItemIndex() == 0;
+    tapsKnob.setEnabled(isChorus);
+    // Each effect has its own delay range, so only the current one's knob is shown.
+    delayKnob.setVisible(isChorus);
+    flangerDelayKnob.setVisible(!isChorus);
+    interpolationSelector.setEnabled(!isChorus);
+    invertButton.setEnabled(!isChorus);
 }
 
-void ChorusFlangerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
-{
-    audioProcessor.rate = rateKnob.getValue();
-    audioProcessor.depth = depthKnob.getValue();
-    audioProcessor.delay = delayKnob.getValue();
-    audioProcessor.feedback = feedbackKnob.getValue();
-}
-
-
-
-
 //==============================================================================
 void ChorusFlangerAudioProcessorEditor::paint (juce::Graphics& g)
 {
@@ -116,5 +98,12 @@ void ChorusFlangerAudioProcessorEditor::resized()
     rateKnob.setBounds(startX, startY, knobWidth, knobHeight);
     depthKnob.setBounds(startX + knobWidth + knobSpacing, startY, knobWidth, knobHeight);
     delayKnob.setBounds(startX + 2 * (knobWidth + knobSpacing), startY, knobWidth, knobHeight);
+    flangerDelayKnob.setBounds(delayKnob.getBounds());
     feedbackKnob.setBounds(startX + 3 * (knobWidth + knobSpacing), startY, knobWidth, knobHeight);
+    tapsKnob.setBounds(startX + 4 * (knobWidth + knobSpacing), startY, knobWidth, knobHeight);
+
+    interpolationSelector.setBounds(startX, startY + knobHeight + 30, 2 * knobWidth + knobSpacing, 24);
+    invertButton.setBounds(startX + 2 * (knobWidth + knobSpacing), startY + knobHeight + 30, 2 * knobWidth + knobSpacing, 24);
+
+    loadDisplay.setBounds(10, getHeight() - 30, getWidth() - 20, 20);
 }
@@ -10,13 +10,12 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "../Shared/LoadMeterDisplay.h"
 
 //==============================================================================
 /**
 */
-class ChorusFlangerAudioProcessorEditor  : public juce::AudioProcessorEditor,
-	public juce::Slider::Listener,
-	public juce::ComboBox::Listener
+class ChorusFlangerAudioProcessorEditor  : public juce::AudioProcessorEditor
 {
 public:
     ChorusFlangerAudioProcessorEditor (ChorusFlangerAudioProcessor&);
@@ -25,25 +24,48 @@ public:
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
-	void setupKnob(juce::Slider& knob, juce::Label& label, const juce::String& name, float min, float max, float defaultVal);
-	void sliderValueChanged(juce::Slider* slider);
-    void comboBoxChanged(juce::ComboBox* comboBox);
 
 private:
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+
+	void setupKnob(juce::Slider& knob, juce::Label& label, const juce::String& name);
+    // Greys out the controls the current mode ignores.
+    void updateModeControls();
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
 	juce::Slider rateKnob;
 	juce::Slider depthKnob;
 	juce::Slider delayKnob;
+	juce::Slider flangerDelayKnob;
 	juce::Slider feedbackKnob;
+	juce::Slider tapsKnob;
 	juce::ComboBox modeSelector;
+	juce::ComboBox interpolationSelector;
+	juce::ToggleButton invertButton { "Invert feedback" };
 
 	juce::Label rateLabel;
 	juce::Label depthLabel;
 	juce::Label delayLabel;
+	juce::Label flangerDelayLabel;
 	juce::Label feedbackLabel;
+	juce::Label tapsLabel;
 
     ChorusFlangerAudioProcessor& audioProcessor;
+	LoadMeterDisplay loadDisplay;
+
+    // After the controls, so they are destroyed first.
+    std::unique_ptr<ComboBoxAttachment> modeAttachment;
+    std::unique_ptr<SliderAttachment> rateAttachment;
+    std::unique_ptr<SliderAttachment> depthAttachment;
+    std::unique_ptr<SliderAttachment> delayAttachment;
+    std::unique_ptr<SliderAttachment> flangerDelayAttachment;
+    std::unique_ptr<SliderAttachment> feedbackAttachment;
+    std::unique_ptr<SliderAttachment> tapsAttachment;
+    std::unique_ptr<ComboBoxAttachment> interpolationAttachment;
+    std::unique_ptr<ButtonAttachment> invertAttachment;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChorusFlangerAudioProcessorEditor)
 };
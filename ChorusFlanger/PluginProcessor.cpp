@@ -8,26 +8,91 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "../Shared/RealtimeSafety.h"
+
+namespace
+{
+    const juce::uint16 stateVersion = 1;
+
+    // The keys are in saved states, so never renumber or reuse one.
+    enum : juce::uint16
+    {
+        chorusKey = 1,
+        rateKey = 2,
+        depthKey = 3,
+        delayKey = 4,
+        feedbackKey = 5,
+        interpolationKey = 6,
+        invertFeedbackKey = 7,
+        chorusTapsKey = 8,
+        flangerDelayKey = 9
+    };
+
+    // The flanger's delay is a parameter of its own, over the short range that makes it a
+    // flanger; the line itself could take the chorus's delays too.
+    const float maxFlangerDelayMilliseconds = 10.0f;
+}
 
 //==============================================================================
 ChorusFlangerAudioProcessor::ChorusFlangerAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
+                      #if ! JucePlugin_IsSynth || EMBEDDED_ENGINE
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
+    , parameters (*this, nullptr, "ChorusFlanger", createParameterLayout())
 {
+    parameterValues.mode = parameters.getRawParameterValue ("mode");
+    parameterValues.rate = parameters.getRawParameterValue ("rate");
+    parameterValues.depth = parameters.getRawParameterValue ("depth");
+    parameterValues.delay = parameters.getRawParameterValue ("delay");
+    parameterValues.flangerDelay = parameters.getRawParameterValue ("flangerDelay");
+    parameterValues.feedback = parameters.getRawParameterValue ("feedback");
+    parameterValues.chorusTaps = parameters.getRawParameterValue ("chorusTaps");
+    parameterValues.interpolation = parameters.getRawParameterValue ("interpolation");
+    parameterValues.invertFeedback = parameters.getRawParameterValue ("invertFeedback");
 }
 
 ChorusFlangerAudioProcessor::~ChorusFlangerAudioProcessor()
 {
 }
 
+juce::AudioProcessorValueTreeState::ParameterLayout ChorusFlangerAudioProcessor::createParameterLayout()
+{
+    juce::NormalisableRange<float> rateRange (0.1f, 20.0f, 0.01f);
+    rateRange.setSkewForCentre (2.0f);
+    juce::NormalisableRange<float> delayRange (MultiTapChorus::minDelayMilliseconds, MultiTapChorus::maxDelayMilliseconds, 0.01f);
+    delayRange.setSkewForCentre (10.0f);
+    juce::NormalisableRange<float> flangerDelayRange (Flanger::minDelayMilliseconds, maxFlangerDelayMilliseconds, 0.01f);
+    flangerDelayRange.setSkewForCentre (2.0f);
+
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { "mode", 1 }, "Mode", juce::StringArray { "Chorus", "Flanger" }, 0));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "rate", 1 }, "Rate", rateRange, 5.0f));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "depth", 1 }, "Depth", juce::NormalisableRange<float> (0.0f, 1.0f, 0.01f), 0.6f));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "delay", 1 }, "Chorus Delay", delayRange, 15.0f));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "flangerDelay", 1 }, "Flanger Delay", flangerDelayRange, 2.0f));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "feedback", 1 }, "Feedback", juce::NormalisableRange<float> (0.0f, Flanger::maxFeedback, 0.01f), 0.05f));
+    layout.add (std::make_unique<juce::AudioParameterInt> (juce::ParameterID { "chorusTaps", 1 }, "Voices", 1, MultiTapChorus::maxTaps, 3));
+    layout.add (std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { "interpolation", 1 }, "Interpolation", juce::StringArray { "Linear", "Cubic", "Allpass" }, 1));
+    layout.add (std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "invertFeedback", 1 }, "Invert Feedback", false));
+    return layout;
+}
+
+void ChorusFlangerAudioProcessor::setParameterValue (const juce::String& parameterID, float value)
+{
+    // Values come from saved states, where NaN or infinity can only mean damage.
+    if (! std::isfinite (value))
+        return;
+    if (auto* parameter = parameters.getParameter (parameterID))
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+}
+
 //==============================================================================
 const juce::String ChorusFlangerAudioProcessor::getName() const
 {
@@ -63,7 +128,17 @@ bool ChorusFlangerAudioProcessor::isMidiEffect() const
 
 double ChorusFlangerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The longest either effect's line can delay the input, then one more of those per trip
+    // round the feedback until the echoes are 120 dB down. Both count, since a mode switch
+    // runs the two together.
+    const auto chorusDelay = parameterValues.delay->load() + MultiTapChorus::maxSweepMilliseconds;
+    const auto flangerDelay = 2.0f * parameterValues.flangerDelay->load();
+    const auto longestDelay = 0.001 * juce::jmax (chorusDelay, flangerDelay);
+
+    const auto feedback = std::abs (parameterValues.feedback->load());
+    if (feedback <= 0.0f)
+        return longestDelay;
+    return longestDelay * (1.0 + std::log (1.0e-6) / std::log ((double) feedback));
 }
 
 int ChorusFlangerAudioProcessor::getNumPrograms()
@@ -93,25 +168,32 @@ void ChorusFlangerAudioProcessor::changeProgramName (int index, const juce::Stri
 //==============================================================================
 void ChorusFlangerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
-
-    chorusEffect.prepare(spec);
-    flangerEffect.prepare(spec);
-
-    flangerEffect.setRate(rate);
-    flangerEffect.setDepth(depth);
-    flangerEffect.setCentreFrequency(1 / delay);
-    flangerEffect.setMix(1);
-    flangerEffect.setFeedback(feedback);
-
-    chorusEffect.setRate(rate);
-    chorusEffect.setDepth(depth);
-    chorusEffect.setCentreDelay(delay);
-    chorusEffect.setMix(1);
-    chorusEffect.setFeedback(feedback);
+    const std::pair<juce::SmoothedValue<float>*, std::atomic<float>*> smoothed[] = {
+        { &rateSmoother, parameterValues.rate }, { &depthSmoother, parameterValues.depth },
+        { &delaySmoother, parameterValues.delay }, { &flangerDelaySmoother, parameterValues.flangerDelay },
+        { &feedbackSmoother, parameterValues.feedback }
+    };
+    for (auto& [smoother, value] : smoothed)
+    {
+        smoother->reset (sampleRate, smoothingSeconds);
+        smoother->setCurrentAndTargetValue (value->load());
+    }
+    modeFade.reset (sampleRate, modeFadeSeconds);
+    modeFade.setCurrentAndTargetValue (parameterValues.mode->load() >= 0.5f ? 1.0f : 0.0f);
+
+    appliedTaps = juce::roundToInt (parameterValues.chorusTaps->load());
+    appliedInterpolation = juce::roundToInt (parameterValues.interpolation->load());
+    appliedInvert = parameterValues.invertFeedback->load() >= 0.5f;
+    chorusEffect.setNumTaps (appliedTaps);
+    flangerEffect.setInterpolation ((Flanger::Interpolation) (Flanger::LinearInterpolation + appliedInterpolation));
+    applySettings();
+    settingsChanged = false;
+
+    chorusEffect.prepare (sampleRate);
+    flangerEffect.prepare (sampleRate, samplesPerBlock);
+    fadeBuffer.setSize (getTotalNumOutputChannels(), smoothingSubBlock);
+
+    loadMeter.prepare(sampleRate);
 }
 
 void ChorusFlangerAudioProcessor::releaseResources()
@@ -136,7 +218,7 @@ bool ChorusFlangerAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
         return false;
 
     // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
+   #if ! JucePlugin_IsSynth || EMBEDDED_ENGINE
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
    #endif
@@ -148,6 +230,8 @@ bool ChorusFlangerAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
 
 void ChorusFlangerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    const RealtimeSafety::ScopedCheck realtimeCheck;
+    const LoadMeter::ScopedTimer loadTimer(loadMeter, buffer.getNumSamples());
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -155,27 +239,106 @@ void ChorusFlangerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    juce::dsp::AudioBlock<float> block(buffer);
-    juce::dsp::ProcessContextReplacing<float> context(block);
+    const int numSamples = buffer.getNumSamples();
+
+    // A target that hasn't moved leaves its smoother, and so the engines, alone.
+    rateSmoother.setTargetValue (parameterValues.rate->load (std::memory_order_relaxed));
+    depthSmoother.setTargetValue (parameterValues.depth->load (std::memory_order_relaxed));
+    delaySmoother.setTargetValue (parameterValues.delay->load (std::memory_order_relaxed));
+    flangerDelaySmoother.setTargetValue (parameterValues.flangerDelay->load (std::memory_order_relaxed));
+    feedbackSmoother.setTargetValue (parameterValues.feedback->load (std::memory_order_relaxed));
 
-    if (isChorus)
+    const auto modeTarget = parameterValues.mode->load (std::memory_order_relaxed) >= 0.5f ? 1.0f : 0.0f;
+    if (modeTarget != modeFade.getTargetValue())
     {
-        chorusEffect.setRate(rate);
-        chorusEffect.setDepth(depth);
-		chorusEffect.setCentreDelay(delay);
-        chorusEffect.setFeedback(feedback);
-        chorusEffect.setMix(1);
-        chorusEffect.process(context);
+        // The engine fading in starts from silence, not from whatever it held when it last ran.
+        if (modeTarget == 1.0f)
+            flangerEffect.reset();
+        else
+            chorusEffect.reset();
+        modeFade.setTargetValue (modeTarget);
     }
-    else
+
+    const int taps = juce::roundToInt (parameterValues.chorusTaps->load (std::memory_order_relaxed));
+    if (taps != appliedTaps)
     {
-        flangerEffect.setRate(rate);
-        flangerEffect.setDepth(depth);
-        flangerEffect.setCentreFrequency(1 / delay);
-        flangerEffect.setFeedback(feedback);
-        flangerEffect.setMix(1);
-        flangerEffect.process(context);
+        chorusEffect.setNumTaps (taps);
+        appliedTaps = taps;
     }
+    const int interpolation = juce::roundToInt (parameterValues.interpolation->load (std::memory_order_relaxed));
+    if (interpolation != appliedInterpolation)
+    {
+        flangerEffect.setInterpolation ((Flanger::Interpolation) (Flanger::LinearInterpolation + interpolation));
+        appliedInterpolation = interpolation;
+    }
+    const bool invert = parameterValues.invertFeedback->load (std::memory_order_relaxed) >= 0.5f;
+    if (invert != appliedInvert)
+    {
+        appliedInvert = invert;
+        settingsChanged = true;
+    }
+
+    for (int start = 0; start < numSamples;)
+    {
+        const bool smoothing = rateSmoother.isSmoothing() || depthSmoother.isSmoothing()
+                               || delaySmoother.isSmoothing() || flangerDelaySmoother.isSmoothing()
+                               || feedbackSmoother.isSmoothing();
+        const bool fading = modeFade.isSmoothing();
+        const int length = smoothing || fading ? juce::jmin (numSamples - start, smoothingSubBlock) : numSamples - start;
+
+        if (smoothing || settingsChanged)
+        {
+            rateSmoother.skip (length);
+            depthSmoother.skip (length);
+            delaySmoother.skip (length);
+            flangerDelaySmoother.skip (length);
+            feedbackSmoother.skip (length);
+            applySettings();
+            settingsChanged = false;
+        }
+
+        if (! fading)
+        {
+            processEffect (modeFade.getTargetValue() < 0.5f, buffer, start, length);
+        }
+        else
+        {
+            // The chorus in place and the flanger on a copy, then mixed along the fade.
+            const int numChannels = juce::jmin (buffer.getNumChannels(), fadeBuffer.getNumChannels());
+            for (int channel = 0; channel < numChannels; ++channel)
+                fadeBuffer.copyFrom (channel, 0, buffer, channel, start, length);
+
+            processEffect (true, buffer, start, length);
+            processEffect (false, fadeBuffer, 0, length);
+
+            const auto startMix = modeFade.getCurrentValue();
+            const auto endMix = modeFade.skip (length);
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                buffer.applyGainRamp (channel, start, length, 1.0f - startMix, 1.0f - endMix);
+                buffer.addFromWithRamp (channel, start, fadeBuffer.getReadPointer (channel), length, startMix, endMix);
+            }
+        }
+
+        start += length;
+    }
+}
+
+void ChorusFlangerAudioProcessor::applySettings()
+{
+    const auto rate = rateSmoother.getCurrentValue();
+    const auto depth = depthSmoother.getCurrentValue();
+    const auto feedback = feedbackSmoother.getCurrentValue();
+    chorusEffect.setParameters (rate, depth, delaySmoother.getCurrentValue(), feedback);
+    flangerEffect.setParameters (rate, depth, flangerDelaySmoother.getCurrentValue(), appliedInvert ? -feedback : feedback);
+}
+
+void ChorusFlangerAudioProcessor::processEffect (bool chorus, juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (chorus)
+        chorusEffect.process (buffer, startSample, numSamples);
+    else
+        flangerEffect.process (buffer, startSample, numSamples);
 }
 
 //==============================================================================
@@ -192,20 +355,59 @@ juce::AudioProcessorEditor* ChorusFlangerAudioProcessor::createEditor()
 //==============================================================================
 void ChorusFlangerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // The keys predate the parameters, so the mode is still saved as "is chorus" and
+    // the interpolation as its Flanger::Interpolation value.
+    PluginState::Writer writer(destData, stateTag, stateVersion);
+    writer.add(chorusKey, parameterValues.mode->load() < 0.5f ? 1.0f : 0.0f);
+    writer.add(rateKey, parameterValues.rate->load());
+    writer.add(depthKey, parameterValues.depth->load());
+    writer.add(delayKey, parameterValues.delay->load());
+    writer.add(feedbackKey, parameterValues.feedback->load());
+    writer.add(interpolationKey, (float) (Flanger::LinearInterpolation + juce::roundToInt (parameterValues.interpolation->load())));
+    writer.add(invertFeedbackKey, parameterValues.invertFeedback->load());
+    writer.add(chorusTapsKey, parameterValues.chorusTaps->load());
+    writer.add(flangerDelayKey, parameterValues.flangerDelay->load());
 }
 
 void ChorusFlangerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // The parameters' ranges clamp whatever a damaged state holds.
+    const PluginState::Reader reader(data, sizeInBytes, stateTag);
+    bool hasFlangerDelay = false;
+    for (int i = 0; i < reader.getNumFields(); ++i)
+        hasFlangerDelay = hasFlangerDelay || reader.getKey(i) == flangerDelayKey;
+
+    for (int i = 0; i < reader.getNumFields(); ++i)
+    {
+        const auto value = reader.getValue(i);
+        switch (reader.getKey(i))
+        {
+        case chorusKey:         setParameterValue ("mode", value >= 0.5f ? 0.0f : 1.0f); break;
+        case rateKey:           setParameterValue ("rate", value); break;
+        case depthKey:          setParameterValue ("depth", value); break;
+        case delayKey:
+            setParameterValue ("delay", value);
+            // Saved before the flanger had a delay of its own, when both effects shared this one.
+            if (! hasFlangerDelay)
+                setParameterValue ("flangerDelay", value);
+            break;
+        case flangerDelayKey:   setParameterValue ("flangerDelay", value); break;
+        case feedbackKey:       setParameterValue ("feedback", value); break;
+        case interpolationKey:  setParameterValue ("interpolation", value - (float) Flanger::LinearInterpolation); break;
+        case invertFeedbackKey: setParameterValue ("invertFeedback", value >= 0.5f ? 1.0f : 0.0f); break;
+        case chorusTapsKey:     setParameterValue ("chorusTaps", value); break;
+        default:                break;
+        }
+    }
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
+// Targets that build this processor in as a stage of their own define EMBEDDED_ENGINE=1;
+// it is an effect there even when that target is an instrument, so it keeps its input.
+#if ! EMBEDDED_ENGINE
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new ChorusFlangerAudioProcessor();
 }
+#endif
@@ -9,6 +9,10 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "Flanger.h"
+#include "MultiTapChorus.h"
+#include "../Shared/LoadMeter.h"
+#include "../Shared/PluginState.h"
 
 //==============================================================================
 /**
@@ -50,19 +54,63 @@ public:
     void changeProgramName (int index, const juce::String& newName) override;
 
     //==============================================================================
+    // A PluginState with this tag. Before it, nothing was saved.
+    static constexpr juce::uint32 stateTag = PluginState::makeTag("ChFl");
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-	//==============================================================================
-	bool isChorus = true;
-	float rate;
-    float depth;
-    float delay;
-    float feedback;
+    // processBlock's DSP load, for the editor and for tests.
+    LoadMeter loadMeter;
+
+    //==============================================================================
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    // mode, rate, depth, delay, flangerDelay, feedback, chorusTaps, interpolation and
+    // invertFeedback; delay is the chorus's, and the chorus ignores the last two and the
+    // flanger chorusTaps.
+    juce::AudioProcessorValueTreeState parameters;
+
+    // Rate, depth, the delays and feedback glide over smoothingSeconds, and a mode switch
+    // crossfades over modeFadeSeconds.
+    static constexpr double smoothingSeconds = 0.05;
+    static constexpr double modeFadeSeconds = 0.03;
 
 private:
-    juce::dsp::Chorus<float> chorusEffect;
-    juce::dsp::Phaser<float> flangerEffect;
+    // Raw values of the parameters, cached so the audio thread never looks them up by name.
+    struct ParameterValues
+    {
+        std::atomic<float>* mode;
+        std::atomic<float>* rate;
+        std::atomic<float>* depth;
+        std::atomic<float>* delay;
+        std::atomic<float>* flangerDelay;
+        std::atomic<float>* feedback;
+        std::atomic<float>* chorusTaps;
+        std::atomic<float>* interpolation;
+        std::atomic<float>* invertFeedback;
+    };
+
+    void setParameterValue (const juce::String& parameterID, float value);
+    // Hands the engines the smoothed values; only called while they are moving.
+    void applySettings();
+    void processEffect (bool chorus, juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    ParameterValues parameterValues;
+    // While smoothing, the engines get new settings every smoothingSubBlock samples.
+    static constexpr int smoothingSubBlock = 32;
+    juce::SmoothedValue<float> rateSmoother, depthSmoother, delaySmoother, flangerDelaySmoother, feedbackSmoother;
+    // What the engines were last given, so a block only updates what changed.
+    int appliedTaps = 0;
+    int appliedInterpolation = 0;
+    bool appliedInvert = false;
+    bool settingsChanged = true;
+
+    // 0 for the chorus, 1 for the flanger; between them both run and are mixed.
+    juce::SmoothedValue<float> modeFade;
+    // The other engine's input and output during a crossfade, one sub-block at a time.
+    juce::AudioBuffer<float> fadeBuffer;
+
+    MultiTapChorus chorusEffect;
+    Flanger flangerEffect;
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChorusFlangerAudioProcessor)
 };
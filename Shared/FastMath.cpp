@@ -0,0 +1,63 @@
+#include "FastMath.h"
+
+namespace
+{
+    using FastMath::FloatVec;
+    constexpr int laneWidth = (int)FloatVec::SIMDNumElements;
+
+    template <typename Function>
+    void forEachRegister(float* destination, const float* source, int num, Function&& function)
+    {
+        int start = 0;
+        if (FloatVec::isSIMDAligned(destination) && FloatVec::isSIMDAligned(source))
+            for (; start + laneWidth <= num; start += laneWidth)
+                function(FloatVec::fromRawArray(source + start)).copyToRawArray(destination + start);
+
+        // Unaligned buffers, and the last partial register, go through an aligned copy.
+        alignas(FloatVec::SIMDRegisterSize) float scratch[laneWidth] = {};
+        for (; start < num; start += laneWidth)
+        {
+            const int count = juce::jmin(laneWidth, num - start);
+            std::memcpy(scratch, source + start, sizeof(float) * (size_t)count);
+            function(FloatVec::fromRawArray(scratch)).copyToRawArray(scratch);
+            std::memcpy(destination + start, scratch, sizeof(float) * (size_t)count);
+        }
+    }
+}
+
+namespace FastMath
+{
+    void sin(float* destination, const float* cycles, int num)
+    {
+        forEachRegister(destination, cycles, num, [](FloatVec x) { return sin(x); });
+    }
+
+    void cos(float* destination, const float* cycles, int num)
+    {
+        forEachRegister(destination, cycles, num, [](FloatVec x) { return cos(x); });
+    }
+
+    void exp2(float* destination, const float* source, int num)
+    {
+        forEachRegister(destination, source, num, [](FloatVec x) { return exp2(x); });
+    }
+
+    void noteToFrequency(float* destination, const float* notes, int num)
+    {
+        const auto semitone = FloatVec::expand(1.0f / 12.0f);
+        const auto a4 = FloatVec::expand(69.0f);
+        const auto a4Hz = FloatVec::expand(440.0f);
+        forEachRegister(destination, notes, num, [&](FloatVec note) { return a4Hz * exp2((note - a4) * semitone); });
+    }
+
+    void decibelsToGain(float* destination, const float* decibels, int num, float minusInfinityDb)
+    {
+        // 10^(dB / 20) = 2^(dB * log2(10) / 20)
+        const auto scale = FloatVec::expand(0.166096404f);
+        const auto floorDb = FloatVec::expand(minusInfinityDb);
+        forEachRegister(destination, decibels, num, [&](FloatVec db)
+        {
+            return exp2(db * scale) & FloatVec::greaterThan(db, floorDb);
+        });
+    }
+}
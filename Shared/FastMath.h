@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    Polynomial sine, cosine and exp2, a SIMD register at a time, with block
+    kernels built on them for LFOs and pitch and level conversions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstring>
+
+// Angles are in cycles, so sin(x) here is sin(2 pi x): oscillator and LFO phases are
+// already in cycles, and the range reduction is then exact.
+namespace FastMath
+{
+    using FloatVec = juce::dsp::SIMDRegister<float>;
+    using IntVec = FloatVec::vMaskType;
+
+    // Error bounds, which the Synth's --bench mode checks.
+    // Absolute, for |cycles| < 1024; larger angles keep fewer bits of their fraction,
+    // as any float phase does.
+    constexpr double sinMaxError = 1.0e-6;
+    // Relative, for x in [-126, 126]; beyond that exp2 clamps.
+    constexpr double exp2MaxRelativeError = 3.0e-7;
+    // noteToFrequency and decibelsToGain: exp2 with one more rounding from scaling the input.
+    constexpr double conversionMaxRelativeError = 1.0e-6;
+
+    // The same bits seen as the other type; compilers drop the copy.
+    inline IntVec toBits(FloatVec x)    { IntVec bits; std::memcpy(&bits, &x, sizeof(x)); return bits; }
+    inline FloatVec fromBits(IntVec x)  { FloatVec value; std::memcpy(&value, &x, sizeof(x)); return value; }
+
+    // SIMDRegister has no shifts, so these use the platform's, or go lane by lane where
+    // JUCE falls back to plain arrays.
+    template <int bits>
+    inline IntVec shiftLeft(IntVec x)
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        return IntVec::fromNative(_mm_slli_epi32(x.value, bits));
+       #elif JUCE_USE_ARM_NEON
+        return IntVec::fromNative(vshlq_n_u32(x.value, bits));
+       #else
+        for (size_t i = 0; i < IntVec::SIMDNumElements; ++i)
+            x.set(i, x.get(i) << bits);
+        return x;
+       #endif
+    }
+
+    template <int bits>
+    inline IntVec shiftRight(IntVec x)
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        return IntVec::fromNative(_mm_srli_epi32(x.value, bits));
+       #elif JUCE_USE_ARM_NEON
+        return IntVec::fromNative(vshrq_n_u32(x.value, bits));
+       #else
+        for (size_t i = 0; i < IntVec::SIMDNumElements; ++i)
+            x.set(i, x.get(i) >> bits);
+        return x;
+       #endif
+    }
+
+    inline FloatVec floor(FloatVec x)
+    {
+        const auto truncated = FloatVec::truncate(x);
+        return truncated - (FloatVec::expand(1.0f) & FloatVec::greaterThan(truncated, x));
+    }
+
+    // sin(pi / 2 * t) for t in [-1, 1], an odd degree 7 minimax polynomial with a max
+    // absolute error of 6e-7. The oscillators fold their phase to t themselves.
+    inline FloatVec sinHalfPi(FloatVec t)
+    {
+        const auto t2 = t * t;
+        auto p = FloatVec::multiplyAdd(FloatVec::expand(0.0794343438f), t2, FloatVec::expand(-0.00433309482f));
+        p = FloatVec::multiplyAdd(FloatVec::expand(-0.645892849f), t2, p);
+        p = FloatVec::multiplyAdd(FloatVec::expand(1.57079101f), t2, p);
+        return t * p;
+    }
+
+    inline FloatVec sin(FloatVec cycles)
+    {
+        // Folds a quarter-cycle-shifted phase to the triangle that sinHalfPi expects.
+        const auto shifted = cycles + FloatVec::expand(0.25f);
+        const auto x = shifted - floor(shifted) - FloatVec::expand(0.5f);
+        const auto absX = FloatVec::max(x, FloatVec::expand(0.0f) - x);
+        return sinHalfPi(FloatVec::expand(1.0f) - FloatVec::expand(4.0f) * absX);
+    }
+
+    inline FloatVec cos(FloatVec cycles)
+    {
+        return sin(cycles + FloatVec::expand(0.25f));
+    }
+
+    inline FloatVec exp2(FloatVec x)
+    {
+        x = FloatVec::min(FloatVec::max(x, FloatVec::expand(-126.0f)), FloatVec::expand(126.0f));
+        const auto whole = floor(x);
+        const auto f = x - whole;
+
+        // 2^f for f in [0, 1), degree 5, fitted for relative error with the ends pinned
+        // to 1 and 2 so that whole powers come out exact and the pieces join up.
+        auto p = FloatVec::multiplyAdd(FloatVec::expand(0.00899099600f), f, FloatVec::expand(0.00187931820f));
+        p = FloatVec::multiplyAdd(FloatVec::expand(0.0558186754f), f, p);
+        p = FloatVec::multiplyAdd(FloatVec::expand(0.240159272f), f, p);
+        p = FloatVec::multiplyAdd(FloatVec::expand(0.693151739f), f, p);
+        p = FloatVec::multiplyAdd(FloatVec::expand(1.0f), f, p);
+
+        // Adding 1.5 * 2^23 leaves the whole part in the low mantissa bits; moved up into
+        // the exponent field, it scales p by 2^whole.
+        const auto magic = FloatVec::expand(12582912.0f);
+        const auto exponent = shiftLeft<23>(toBits(whole + magic) - toBits(magic));
+        return fromBits(toBits(p) + exponent);
+    }
+
+    // Single values, for control-rate callers.
+    inline float sin(float cycles)  { return sin(FloatVec::expand(cycles)).get(0); }
+    inline float cos(float cycles)  { return cos(FloatVec::expand(cycles)).get(0); }
+    inline float exp2(float x)      { return exp2(FloatVec::expand(x)).get(0); }
+
+    // Block kernels: num values from source to destination, which may be the same
+    // buffer. Neither needs to be aligned, and any num is fine.
+    void sin(float* destination, const float* cycles, int num);
+    void cos(float* destination, const float* cycles, int num);
+    void exp2(float* destination, const float* source, int num);
+    // MIDI note numbers, fractional for pitch bend or detune, to Hz at A4 = 440 Hz.
+    void noteToFrequency(float* destination, const float* notes, int num);
+    // Anything at or below minusInfinityDb gives exactly 0.
+    void decibelsToGain(float* destination, const float* decibels, int num, float minusInfinityDb = -100.0f);
+}
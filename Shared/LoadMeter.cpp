@@ -0,0 +1,96 @@
+#include "LoadMeter.h"
+
+namespace
+{
+    // Long enough for the clocks' read costs not to matter, short enough for prepareToPlay.
+    const double calibrationSeconds = 0.002;
+
+    double measureCounterTicksPerSecond()
+    {
+       #if JUCE_INTEL
+        const auto clockRate = (double)juce::Time::getHighResolutionTicksPerSecond();
+        const auto interval = (juce::int64)(calibrationSeconds * clockRate);
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        const auto startCounter = LoadMeter::readCounter();
+        juce::int64 ticks = 0;
+        while (ticks < interval)
+            ticks = juce::Time::getHighResolutionTicks() - startTicks;
+        return (double)(LoadMeter::readCounter() - startCounter) * clockRate / (double)ticks;
+       #elif defined (__aarch64__) && ! JUCE_MSVC
+        juce::uint64 frequency;
+        asm volatile ("mrs %0, cntfrq_el0" : "=r" (frequency));
+        return (double)frequency;
+       #else
+        return (double)juce::Time::getHighResolutionTicksPerSecond();
+       #endif
+    }
+}
+
+double LoadMeter::getCounterTicksPerSecond()
+{
+    // Once per process; every meter shares the figure.
+    static const double ticksPerSecond = measureCounterTicksPerSecond();
+    return ticksPerSecond;
+}
+
+void LoadMeter::prepare(double sampleRate)
+{
+    ticksPerSample = getCounterTicksPerSecond() / sampleRate;
+    clear();
+}
+
+float LoadMeter::getPercentileLoad(float percentile) const
+{
+    juce::uint64 total = 0;
+    for (const auto& bin : bins)
+        total += bin.load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0.0f;
+
+    // Nearest rank; the slack stops 0.99f, which is a touch over 0.99, rounding up a rank.
+    const auto rank = (double)percentile * (double)total;
+    const auto target = juce::jmax((juce::uint64)1, (juce::uint64)std::ceil(rank * (1.0 - 1.0e-6)));
+    juce::uint64 count = 0;
+    for (int i = 0; i < numBins; ++i)
+    {
+        count += bins[(size_t)i].load(std::memory_order_relaxed);
+        if (count >= target)
+            return juce::jmin((float)(i + 1) * binWidth, getPeakLoad());
+    }
+
+    return getPeakLoad();
+}
+
+void LoadMeter::reset()
+{
+    resetPending.store(true, std::memory_order_release);
+}
+
+void LoadMeter::addBlock(juce::int64 ticks, int numSamples)
+{
+    if (numSamples <= 0 || ticksPerSample <= 0.0)
+        return;
+
+    if (resetPending.load(std::memory_order_relaxed) && resetPending.exchange(false, std::memory_order_acquire))
+        clear();
+
+    const auto load = (float)((double)ticks / (ticksPerSample * numSamples));
+    const auto bin = juce::jmin(numBins, (int)(load / binWidth));
+
+    // Only this thread writes, so a load and a store are enough; no locked increments.
+    auto& counter = bins[(size_t)bin];
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    currentLoad.store(load, std::memory_order_relaxed);
+    if (load > peakLoad.load(std::memory_order_relaxed))
+        peakLoad.store(load, std::memory_order_relaxed);
+    numBlocks.store(numBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void LoadMeter::clear()
+{
+    for (auto& bin : bins)
+        bin.store(0, std::memory_order_relaxed);
+    currentLoad.store(0.0f, std::memory_order_relaxed);
+    peakLoad.store(0.0f, std::memory_order_relaxed);
+    numBlocks.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    DSP load of a processor's processBlock: the time each block took as a
+    fraction of the time it plays for, with a histogram for percentiles.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+// The audio thread is the only writer and never waits; readers on other threads see
+// relaxed snapshots, which is all a meter needs.
+class LoadMeter
+{
+public:
+    // 1% wide bins up to 200%, and one more for anything slower.
+    static constexpr int numBins = 200;
+    static constexpr float binWidth = 0.01f;
+
+    LoadMeter() { clear(); }
+    ~LoadMeter() {}
+
+    // Call from prepareToPlay, before any block is timed.
+    void prepare(double sampleRate);
+
+    // The CPU's own counter, a single instruction: the TSC on x86, the virtual counter on
+    // 64-bit ARM. Other targets fall back to high-resolution ticks, since they have no
+    // counter that user code can read portably; there it may be a clock_gettime or
+    // QueryPerformanceCounter call, still tiny next to a block.
+    static juce::int64 readCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return (juce::int64)__rdtsc();
+       #elif defined (__aarch64__) && ! JUCE_MSVC
+        juce::uint64 value;
+        asm volatile ("mrs %0, cntvct_el0" : "=r" (value));
+        return (juce::int64)value;
+       #else
+        return juce::Time::getHighResolutionTicks();
+       #endif
+    }
+    // readCounter's rate; measured against the high-resolution clock once on x86, where
+    // the TSC runs at a fixed rate that nothing reports.
+    static double getCounterTicksPerSecond();
+
+    // Times one processBlock. Declare it at the top, so it covers the whole block.
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(LoadMeter& meter, int numSamples)
+            : meter(meter), numSamples(numSamples), startTicks(readCounter()) {}
+        ~ScopedTimer() { meter.addBlock(readCounter() - startTicks, numSamples); }
+
+    private:
+        LoadMeter& meter;
+        const int numSamples;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedTimer)
+    };
+
+    // 1 means the block took as long to process as it takes to play.
+    float getCurrentLoad() const { return currentLoad.load(std::memory_order_relaxed); }
+    float getPeakLoad() const { return peakLoad.load(std::memory_order_relaxed); }
+    // The upper edge of the bin the percentile (0-1) falls in, so it never under-reports.
+    float getPercentileLoad(float percentile) const;
+    juce::int64 getNumBlocks() const { return numBlocks.load(std::memory_order_relaxed); }
+
+    // Safe from any thread; the figures clear when the next block is timed.
+    void reset();
+
+private:
+    void addBlock(juce::int64 ticks, int numSamples);
+    void clear();
+
+    double ticksPerSample = 0.0;
+    std::array<std::atomic<juce::uint32>, numBins + 1> bins;
+    std::atomic<float> currentLoad { 0.0f };
+    std::atomic<float> peakLoad { 0.0f };
+    std::atomic<juce::int64> numBlocks { 0 };
+    std::atomic<bool> resetPending { false };
+
+    JUCE_DECLARE_NON_COPYABLE(LoadMeter)
+};
@@ -0,0 +1,28 @@
+#include "LoadMeterDisplay.h"
+
+LoadMeterDisplay::LoadMeterDisplay(LoadMeter& meter) : meter(meter)
+{
+    setFont(juce::FontOptions(13.0f));
+    setTooltip("DSP load: the time each block takes as a share of the time it plays for. Click to reset.");
+    timerCallback();
+    startTimerHz(5);
+}
+
+void LoadMeterDisplay::mouseDown(const juce::MouseEvent&)
+{
+    meter.reset();
+    if (onReset)
+        onReset();
+}
+
+void LoadMeterDisplay::timerCallback()
+{
+    auto percent = [](float load) { return juce::String(juce::roundToInt(load * 100.0f)) + "%"; };
+
+    auto text = "DSP " + percent(meter.getCurrentLoad()) + "  peak " + percent(meter.getPeakLoad())
+              + "  p99 " + percent(meter.getPercentileLoad(0.99f));
+    if (getExtraText)
+        text += "  " + getExtraText();
+
+    setText(text, juce::dontSendNotification);
+}
@@ -0,0 +1,37 @@
+/*
+  ==============================================================================
+
+    A one-line readout of a LoadMeter for the plugin editors.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include "LoadMeter.h"
+
+// Shows current, peak and 99th percentile load a few times a second. Clicking it
+// resets the meter.
+class LoadMeterDisplay : public juce::Label,
+    private juce::Timer
+{
+public:
+    explicit LoadMeterDisplay(LoadMeter& meter);
+    ~LoadMeterDisplay() override {}
+
+    // Appended to the readout, for figures of the processor's own like the voice count.
+    std::function<juce::String()> getExtraText;
+    // Called after a click has reset the meter.
+    std::function<void()> onReset;
+
+    void mouseDown(const juce::MouseEvent& event) override;
+
+private:
+    void timerCallback() override;
+
+    LoadMeter& meter;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoadMeterDisplay)
+};
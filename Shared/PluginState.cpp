@@ -0,0 +1,84 @@
+#include "PluginState.h"
+
+namespace
+{
+    void writeLittleEndian(char* destination, juce::uint32 value, int numBytes)
+    {
+        for (int i = 0; i < numBytes; ++i)
+            destination[i] = (char)(value >> (8 * i));
+    }
+}
+
+namespace PluginState
+{
+    bool hasTag(const void* data, int sizeInBytes, juce::uint32 tag)
+    {
+        return data != nullptr && sizeInBytes >= 4 && juce::ByteOrder::littleEndianInt(data) == tag;
+    }
+
+    Writer::Writer(juce::MemoryBlock& destData, juce::uint32 tag, juce::uint16 version)
+        : data(destData)
+    {
+        data.setSize(headerSize);
+        auto* header = static_cast<char*>(data.getData());
+        writeLittleEndian(header, tag, 4);
+        writeLittleEndian(header + 4, version, 2);
+        writeLittleEndian(header + 6, 0, 2);
+    }
+
+    void Writer::add(juce::uint16 key, float value)
+    {
+        jassert(numFields < maxFields);
+        if (numFields >= maxFields)
+            return;
+
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        char field[fieldSize];
+        writeLittleEndian(field, key, 2);
+        writeLittleEndian(field + 2, bits, 4);
+        data.append(field, sizeof(field));
+
+        // The count is kept current, so the block is a complete state after every add.
+        writeLittleEndian(static_cast<char*>(data.getData()) + 6, (juce::uint32)++numFields, 2);
+    }
+
+    Reader::Reader(const void* data, int sizeInBytes, juce::uint32 tag)
+    {
+        if (sizeInBytes < headerSize || !hasTag(data, sizeInBytes, tag))
+            return;
+
+        const auto* header = static_cast<const char*>(data);
+        const int count = juce::ByteOrder::littleEndianShort(header + 6);
+        if (headerSize + count * fieldSize > sizeInBytes)
+            return;
+
+        version = juce::ByteOrder::littleEndianShort(header + 4);
+        numFields = count;
+        fields = header + headerSize;
+
+        // No parameter has a use for NaN or infinity, so they can only mean a damaged state.
+        for (int i = 0; i < numFields; ++i)
+            if (!std::isfinite(getValue(i)))
+            {
+                fields = nullptr;
+                numFields = 0;
+                return;
+            }
+    }
+
+    juce::uint16 Reader::getKey(int index) const
+    {
+        jassert(index >= 0 && index < numFields);
+        return juce::ByteOrder::littleEndianShort(fields + index * fieldSize);
+    }
+
+    float Reader::getValue(int index) const
+    {
+        jassert(index >= 0 && index < numFields);
+        const juce::uint32 bits = juce::ByteOrder::littleEndianInt(fields + index * fieldSize + 2);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    The binary state the plugins save: a tag, a version and a flat list of
+    numbered values, little-endian whatever the machine.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// A state is an 8 byte header, the plugin's tag then a 16 bit version and field count,
+// followed by 6 byte fields, each a 16 bit key and a 32 bit float. Readers skip keys they
+// don't know and keep their current value for keys that are missing, so adding a value
+// never needs a new version; bump it only when an existing key changes meaning.
+namespace PluginState
+{
+    constexpr int headerSize = 8;
+    constexpr int fieldSize = 6;
+    constexpr int maxFields = 0xffff;
+
+    // Four characters as the tag's value, so it reads the same in a hex dump on any machine.
+    constexpr juce::uint32 makeTag(const char (&tag)[5])
+    {
+        return (juce::uint32)(unsigned char)tag[0] | (juce::uint32)(unsigned char)tag[1] << 8
+             | (juce::uint32)(unsigned char)tag[2] << 16 | (juce::uint32)(unsigned char)tag[3] << 24;
+    }
+
+    // True if the data starts with the tag, whatever follows.
+    bool hasTag(const void* data, int sizeInBytes, juce::uint32 tag);
+
+    // Replaces destData with the header, then appends a field per add.
+    class Writer
+    {
+    public:
+        Writer(juce::MemoryBlock& destData, juce::uint32 tag, juce::uint16 version);
+
+        void add(juce::uint16 key, float value);
+
+    private:
+        juce::MemoryBlock& data;
+        int numFields = 0;
+
+        JUCE_DECLARE_NON_COPYABLE(Writer)
+    };
+
+    // Reads in place; the data must outlive the reader.
+    class Reader
+    {
+    public:
+        Reader(const void* data, int sizeInBytes, juce::uint32 tag);
+
+        // The tag matched, every field the header counts is inside sizeInBytes and every
+        // value is finite. An invalid reader has no fields.
+        bool isValid() const { return fields != nullptr; }
+        juce::uint16 getVersion() const { return version; }
+        int getNumFields() const { return numFields; }
+        juce::uint16 getKey(int index) const;
+        float getValue(int index) const;
+
+    private:
+        const char* fields = nullptr;
+        juce::uint16 version = 0;
+        int numFields = 0;
+    };
+}
@@ -0,0 +1,202 @@
+#include "PresetBank.h"
+#include "PluginState.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const juce::uint32 bankTag = PluginState::makeTag("PBnk");
+    const juce::uint16 bankVersion = 1;
+
+    void writeLittleEndian(char* destination, juce::uint32 value, int numBytes)
+    {
+        for (int i = 0; i < numBytes; ++i)
+            destination[i] = (char)(value >> (8 * i));
+    }
+
+    char toLowerAscii(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+    }
+
+    // Byte order with ASCII folded to lower case; other UTF-8 bytes compare as they are.
+    int compareNames(const char* a, int aLength, const char* b, int bLength)
+    {
+        const int length = juce::jmin(aLength, bLength);
+        for (int i = 0; i < length; ++i)
+        {
+            const auto x = (unsigned char)toLowerAscii(a[i]);
+            const auto y = (unsigned char)toLowerAscii(b[i]);
+            if (x != y)
+                return x < y ? -1 : 1;
+        }
+        return aLength == bLength ? 0 : (aLength < bLength ? -1 : 1);
+    }
+
+    bool containsName(const char* name, int nameLength, const char* text, int textLength)
+    {
+        for (int start = 0; start + textLength <= nameLength; ++start)
+        {
+            int i = 0;
+            while (i < textLength && toLowerAscii(name[start + i]) == toLowerAscii(text[i]))
+                ++i;
+            if (i == textLength)
+                return true;
+        }
+        return false;
+    }
+}
+
+bool PresetBank::write(const juce::File& file, juce::uint32 pluginTag, std::vector<Preset> presets)
+{
+    std::stable_sort(presets.begin(), presets.end(), [](const Preset& a, const Preset& b)
+    {
+        return compareNames(a.name.toRawUTF8(), (int)a.name.getNumBytesAsUTF8(),
+                            b.name.toRawUTF8(), (int)b.name.getNumBytesAsUTF8()) < 0;
+    });
+
+    juce::MemoryBlock data(headerSize + entrySize * presets.size(), true);
+    juce::MemoryBlock names, states;
+    for (size_t i = 0; i < presets.size(); ++i)
+    {
+        const auto& preset = presets[i];
+        const auto nameBytes = preset.name.getNumBytesAsUTF8();
+        if (nameBytes > (size_t)maxNameBytes)
+            return false;
+
+        auto* entry = static_cast<char*>(data.getData()) + headerSize + entrySize * i;
+        writeLittleEndian(entry, (juce::uint32)names.getSize(), 4);
+        writeLittleEndian(entry + 4, (juce::uint32)nameBytes, 2);
+        writeLittleEndian(entry + 8, (juce::uint32)states.getSize(), 4);
+        writeLittleEndian(entry + 12, (juce::uint32)preset.state.getSize(), 4);
+        names.append(preset.name.toRawUTF8(), nameBytes);
+        states.append(preset.state.getData(), preset.state.getSize());
+
+        // Offsets are 32 bits, and reading keeps sizes to an int.
+        if (data.getSize() + names.getSize() + states.getSize() > (size_t)std::numeric_limits<int>::max())
+            return false;
+    }
+
+    auto* header = static_cast<char*>(data.getData());
+    writeLittleEndian(header, bankTag, 4);
+    writeLittleEndian(header + 4, bankVersion, 2);
+    writeLittleEndian(header + 8, pluginTag, 4);
+    writeLittleEndian(header + 12, (juce::uint32)presets.size(), 4);
+    writeLittleEndian(header + 16, (juce::uint32)names.getSize(), 4);
+    data.append(names.getData(), names.getSize());
+    data.append(states.getData(), states.getSize());
+
+    return file.replaceWithData(data.getData(), data.getSize());
+}
+
+PresetBank::PresetBank(const juce::File& file, juce::uint32 pluginTag)
+{
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    const auto* data = static_cast<const char*>(mapped->getData());
+    const auto fileSize = (juce::int64)mapped->getSize();
+    if (data == nullptr || fileSize < headerSize || fileSize > std::numeric_limits<int>::max()
+        || juce::ByteOrder::littleEndianInt(data) != bankTag
+        || juce::ByteOrder::littleEndianShort(data + 4) != bankVersion
+        || juce::ByteOrder::littleEndianInt(data + 8) != pluginTag)
+        return;
+
+    const juce::int64 count = juce::ByteOrder::littleEndianInt(data + 12);
+    const juce::int64 namesStart = headerSize + count * entrySize;
+    const juce::int64 statesStart = namesStart + juce::ByteOrder::littleEndianInt(data + 16);
+    if (statesStart > fileSize)
+        return;
+
+    index = data + headerSize;
+    names = data + namesStart;
+    states = data + statesStart;
+    numPresets = (int)count;
+
+    // The index and the names are checked here; no state is read until it is asked for.
+    for (int i = 0; i < numPresets; ++i)
+    {
+        const auto* entry = index + entrySize * i;
+        const juce::int64 nameEnd = (juce::int64)juce::ByteOrder::littleEndianInt(entry) + juce::ByteOrder::littleEndianShort(entry + 4);
+        const juce::int64 stateEnd = (juce::int64)juce::ByteOrder::littleEndianInt(entry + 8) + juce::ByteOrder::littleEndianInt(entry + 12);
+        if (namesStart + nameEnd > statesStart || statesStart + stateEnd > fileSize)
+        {
+            numPresets = 0;
+            return;
+        }
+
+        if (i > 0)
+        {
+            const auto previous = getEntry(i - 1), current = getEntry(i);
+            if (compareNames(previous.name, previous.nameLength, current.name, current.nameLength) > 0)
+            {
+                numPresets = 0;
+                return;
+            }
+        }
+    }
+
+    map = std::move(mapped);
+}
+
+PresetBank::Entry PresetBank::getEntry(int indexToGet) const
+{
+    jassert(indexToGet >= 0 && indexToGet < numPresets);
+    const auto* entry = index + entrySize * indexToGet;
+    return { names + juce::ByteOrder::littleEndianInt(entry), (int)juce::ByteOrder::littleEndianShort(entry + 4),
+             states + juce::ByteOrder::littleEndianInt(entry + 8), (int)juce::ByteOrder::littleEndianInt(entry + 12) };
+}
+
+juce::String PresetBank::getName(int indexToGet) const
+{
+    const auto entry = getEntry(indexToGet);
+    return juce::String::fromUTF8(entry.name, entry.nameLength);
+}
+
+const void* PresetBank::getStateData(int indexToGet) const
+{
+    return getEntry(indexToGet).state;
+}
+
+int PresetBank::getStateSize(int indexToGet) const
+{
+    return getEntry(indexToGet).stateSize;
+}
+
+int PresetBank::indexOf(const juce::String& name) const
+{
+    const auto* text = name.toRawUTF8();
+    const int textLength = (int)name.getNumBytesAsUTF8();
+
+    int low = 0, high = numPresets;
+    while (low < high)
+    {
+        const int middle = (low + high) / 2;
+        const auto entry = getEntry(middle);
+        if (compareNames(entry.name, entry.nameLength, text, textLength) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low < numPresets)
+    {
+        const auto entry = getEntry(low);
+        if (compareNames(entry.name, entry.nameLength, text, textLength) == 0)
+            return low;
+    }
+    return -1;
+}
+
+std::vector<int> PresetBank::search(const juce::String& text) const
+{
+    const auto* textBytes = text.toRawUTF8();
+    const int textLength = (int)text.getNumBytesAsUTF8();
+
+    std::vector<int> matches;
+    for (int i = 0; i < numPresets; ++i)
+    {
+        const auto entry = getEntry(i);
+        if (containsName(entry.name, entry.nameLength, textBytes, textLength))
+            matches.push_back(i);
+    }
+    return matches;
+}
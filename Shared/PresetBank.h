@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    A file of named plugin states with an index, memory-mapped so a library
+    of thousands of presets opens at once and is searched by name without
+    reading any of the states.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+// Layout, little-endian: a 20 byte header (the bank tag, a 16 bit version, 16 bits of
+// flags, the plugin's state tag, the preset count and the size of the names), then a
+// 16 byte index entry per preset (name offset, 16 bit name length, 16 bits spare, state
+// offset and state size), then the UTF-8 names, then the states. Entries are sorted by
+// name, ignoring ASCII case, so a lookup by name is a binary search.
+class PresetBank
+{
+public:
+    struct Preset
+    {
+        juce::String name;
+        juce::MemoryBlock state;
+    };
+
+    static constexpr int headerSize = 20;
+    static constexpr int entrySize = 16;
+    static constexpr int maxNameBytes = 0xffff;
+
+    // Sorts the presets and replaces the file. pluginTag is the PluginState tag of the
+    // plugin the states are for. Fails on a name too long to store or a file it can't write.
+    static bool write(const juce::File& file, juce::uint32 pluginTag, std::vector<Preset> presets);
+
+    // Maps the file and checks every index entry lies inside it. Anything that isn't a bank
+    // for pluginTag, or is damaged, opens as an empty bank.
+    PresetBank(const juce::File& file, juce::uint32 pluginTag);
+    ~PresetBank() {}
+
+    bool isValid() const { return map != nullptr; }
+    int size() const { return numPresets; }
+
+    juce::String getName(int index) const;
+    // Points into the mapped file, so valid for as long as the bank is.
+    const void* getStateData(int index) const;
+    int getStateSize(int index) const;
+
+    // The preset with exactly this name, ignoring ASCII case, or -1.
+    int indexOf(const juce::String& name) const;
+    // Every preset whose name contains text, ignoring ASCII case, in name order.
+    std::vector<int> search(const juce::String& text) const;
+
+private:
+    struct Entry
+    {
+        const char* name;
+        int nameLength;
+        const char* state;
+        int stateSize;
+    };
+
+    Entry getEntry(int index) const;
+
+    std::unique_ptr<juce::MemoryMappedFile> map;
+    const char* index = nullptr;
+    const char* names = nullptr;
+    const char* states = nullptr;
+    int numPresets = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(PresetBank)
+};
@@ -0,0 +1,312 @@
+#include "RealtimeSafety.h"
+
+#if REALTIME_SAFETY_CHECKS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+ #include <execinfo.h>
+ #define REALTIME_SAFETY_BACKTRACE 1
+#else
+ #define REALTIME_SAFETY_BACKTRACE 0
+#endif
+
+#if defined(__GLIBC__)
+ #include <cerrno>
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <semaphore.h>
+ #include <time.h>
+ #include <unistd.h>
+
+// glibc's own allocator entry points, so the replacements below can forward to them.
+extern "C"
+{
+    void* __libc_malloc(size_t size) noexcept;
+    void* __libc_calloc(size_t count, size_t size) noexcept;
+    void* __libc_realloc(void* pointer, size_t size) noexcept;
+    void* __libc_memalign(size_t alignment, size_t size) noexcept;
+    void __libc_free(void* pointer) noexcept;
+}
+#endif
+
+namespace
+{
+    constexpr int maxViolations = 64;
+    constexpr int maxFrames = 32;
+
+    // Fixed storage, so recording a violation never allocates.
+    struct Violation
+    {
+        const char* call = nullptr;
+        int numFrames = 0;
+        void* frames[maxFrames];
+    };
+
+    Violation violations[maxViolations];
+    std::atomic<int> numViolations { 0 };
+
+    // Plain thread_locals: they need no initialiser, so reading them can't allocate.
+    thread_local int checkDepth = 0;
+    thread_local bool recording = false;    // the recorder's own calls aren't violations
+
+    void check(const char* call)
+    {
+        if (checkDepth == 0 || recording)
+            return;
+
+        recording = true;
+        const int index = numViolations.fetch_add(1);
+        if (index < maxViolations)
+        {
+            auto& violation = violations[index];
+            violation.call = call;
+#if REALTIME_SAFETY_BACKTRACE
+            violation.numFrames = backtrace(violation.frames, maxFrames);
+#endif
+        }
+        recording = false;
+    }
+
+    void* allocate(std::size_t size)
+    {
+#if defined(__GLIBC__)
+        return __libc_malloc(size);
+#else
+        return std::malloc(size);
+#endif
+    }
+
+    void release(void* pointer)
+    {
+#if defined(__GLIBC__)
+        __libc_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+
+    // The first backtrace loads the unwinder, which allocates; get that done at startup.
+    struct Warmup
+    {
+        Warmup()
+        {
+#if REALTIME_SAFETY_BACKTRACE
+            void* frame[1];
+            backtrace(frame, 1);
+#endif
+        }
+    } warmup;
+}
+
+namespace RealtimeSafety
+{
+    ScopedCheck::ScopedCheck()
+    {
+        ++checkDepth;
+    }
+
+    ScopedCheck::~ScopedCheck()
+    {
+        --checkDepth;
+    }
+
+    int getNumViolations()
+    {
+        return numViolations.load();
+    }
+
+    void printViolations(std::ostream& stream)
+    {
+        const int total = numViolations.load();
+        stream << "Real-time safety: " << total << " violation(s) in checked scopes" << std::endl;
+
+        for (int i = 0; i < total && i < maxViolations; ++i)
+        {
+            const auto& violation = violations[i];
+            stream << "#" << i << " " << violation.call << std::endl;
+
+#if REALTIME_SAFETY_BACKTRACE
+            // Skips the frame for check() itself.
+            if (auto** symbols = backtrace_symbols(violation.frames, violation.numFrames))
+            {
+                for (int frame = 1; frame < violation.numFrames; ++frame)
+                    stream << "    " << symbols[frame] << std::endl;
+                std::free(symbols);
+            }
+#endif
+        }
+
+        if (total > maxViolations)
+            stream << "(stacks kept for the first " << maxViolations << " only)" << std::endl;
+    }
+
+    void clearViolations()
+    {
+        numViolations = 0;
+    }
+}
+
+//==============================================================================
+// Replacing these in the executable overrides the library versions for every caller.
+void* operator new(std::size_t size)
+{
+    check("operator new");
+    if (auto* pointer = allocate(size > 0 ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        check("operator delete");
+    release(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    if (pointer != nullptr)
+        check("operator delete");
+    release(pointer);
+}
+
+#if defined(__GLIBC__)
+namespace
+{
+    // Looked up on first use rather than at startup, as other static constructors may
+    // lock before this file's have run. dlsym itself doesn't go through these symbols.
+    template <typename Function>
+    Function* findNext(std::atomic<Function*>& next, const char* name)
+    {
+        auto* function = next.load(std::memory_order_relaxed);
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function*>(dlsym(RTLD_NEXT, name));
+            next.store(function, std::memory_order_relaxed);
+        }
+        return function;
+    }
+
+    std::atomic<int (*)(pthread_mutex_t*)> nextMutexLock { nullptr };
+    std::atomic<int (*)(pthread_rwlock_t*)> nextReadLock { nullptr };
+    std::atomic<int (*)(pthread_rwlock_t*)> nextWriteLock { nullptr };
+    std::atomic<int (*)(sem_t*)> nextSemaphoreWait { nullptr };
+    std::atomic<ssize_t (*)(int, void*, size_t)> nextRead { nullptr };
+    std::atomic<ssize_t (*)(int, const void*, size_t)> nextWrite { nullptr };
+    std::atomic<int (*)(const timespec*, timespec*)> nextNanosleep { nullptr };
+    std::atomic<int (*)(clockid_t, int, const timespec*, timespec*)> nextClockNanosleep { nullptr };
+    std::atomic<int (*)(useconds_t)> nextUsleep { nullptr };
+    std::atomic<int (*)()> nextSchedYield { nullptr };
+}
+
+extern "C"
+{
+    void* malloc(size_t size) noexcept
+    {
+        check("malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) noexcept
+    {
+        check("calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) noexcept
+    {
+        check("realloc");
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            check("free");
+        __libc_free(pointer);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t size) noexcept
+    {
+        check("posix_memalign");
+        if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        *result = __libc_memalign(alignment, size);
+        return *result != nullptr ? 0 : ENOMEM;
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        check("aligned_alloc");
+        return __libc_memalign(alignment, size);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+    {
+        check("pthread_mutex_lock");
+        return findNext(nextMutexLock, "pthread_mutex_lock")(mutex);
+    }
+
+    int pthread_rwlock_rdlock(pthread_rwlock_t* lock) noexcept
+    {
+        check("pthread_rwlock_rdlock");
+        return findNext(nextReadLock, "pthread_rwlock_rdlock")(lock);
+    }
+
+    int pthread_rwlock_wrlock(pthread_rwlock_t* lock) noexcept
+    {
+        check("pthread_rwlock_wrlock");
+        return findNext(nextWriteLock, "pthread_rwlock_wrlock")(lock);
+    }
+
+    int sem_wait(sem_t* semaphore)
+    {
+        check("sem_wait");
+        return findNext(nextSemaphoreWait, "sem_wait")(semaphore);
+    }
+
+    ssize_t read(int fd, void* buffer, size_t size)
+    {
+        check("read");
+        return findNext(nextRead, "read")(fd, buffer, size);
+    }
+
+    ssize_t write(int fd, const void* buffer, size_t size)
+    {
+        check("write");
+        return findNext(nextWrite, "write")(fd, buffer, size);
+    }
+
+    int nanosleep(const timespec* duration, timespec* remaining)
+    {
+        check("nanosleep");
+        return findNext(nextNanosleep, "nanosleep")(duration, remaining);
+    }
+
+    int clock_nanosleep(clockid_t clock, int flags, const timespec* duration, timespec* remaining)
+    {
+        check("clock_nanosleep");
+        return findNext(nextClockNanosleep, "clock_nanosleep")(clock, flags, duration, remaining);
+    }
+
+    int usleep(useconds_t microseconds)
+    {
+        check("usleep");
+        return findNext(nextUsleep, "usleep")(microseconds);
+    }
+
+    // Doesn't block, but it is a system call and hands the core to the scheduler.
+    int sched_yield() noexcept
+    {
+        check("sched_yield");
+        return findNext(nextSchedYield, "sched_yield")();
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    Debug and test-build checks that the audio callbacks never allocate,
+    lock or make blocking system calls.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <ostream>
+
+// Define REALTIME_SAFETY_CHECKS=1 in a debug or test build to turn the checks on;
+// otherwise everything here compiles away.
+#ifndef REALTIME_SAFETY_CHECKS
+ #define REALTIME_SAFETY_CHECKS 0
+#endif
+
+// While a ScopedCheck is alive on a thread, any call on that thread to operator new or
+// delete, to malloc and friends, to a mutex, rwlock or semaphore wait, or to read,
+// write, sleep or sched_yield is recorded as a violation, with the call stack where it
+// was made.
+//
+// The calls are intercepted by replacing them in the executable, so the checks work in
+// command-line and test targets that link the processors in, not in a plugin a host
+// has loaded. Only operator new and delete are intercepted outside glibc.
+namespace RealtimeSafety
+{
+#if REALTIME_SAFETY_CHECKS
+    class ScopedCheck
+    {
+    public:
+        ScopedCheck();
+        ~ScopedCheck();
+
+        ScopedCheck(const ScopedCheck&) = delete;
+        ScopedCheck& operator=(const ScopedCheck&) = delete;
+    };
+
+    // Every violation so far, including any past the ones whose stacks were kept.
+    int getNumViolations();
+    // Symbolises the stacks, which allocates, so never call this from a checked scope.
+    void printViolations(std::ostream& stream);
+    void clearViolations();
+#else
+    class ScopedCheck
+    {
+    public:
+        ScopedCheck() {}
+    };
+
+    inline int getNumViolations() { return 0; }
+    inline void printViolations(std::ostream&) {}
+    inline void clearViolations() {}
+#endif
+}
@@ -0,0 +1,247 @@
+#include "AutoWah.h"
+#include "../Shared/FastMath.h"
+
+namespace
+{
+    using FloatVec = juce::dsp::SIMDRegister<float>;
+
+    // Adds the samples' squares to sumSquares and raises peak to their largest
+    // magnitude, a SIMD register at a time once the pointer is aligned.
+    void measure(const float* samples, int numSamples, float& sumSquares, float& peak)
+    {
+        int i = 0;
+        for (; i < numSamples && !FloatVec::isSIMDAligned(samples + i); ++i)
+        {
+            sumSquares += samples[i] * samples[i];
+            peak = juce::jmax(peak, std::abs(samples[i]));
+        }
+
+        const auto zero = FloatVec::expand(0.0f);
+        auto squares = zero;
+        auto peaks = zero;
+        for (; i + (int)FloatVec::SIMDNumElements <= numSamples; i += (int)FloatVec::SIMDNumElements)
+        {
+            const auto x = FloatVec::fromRawArray(samples + i);
+            squares = FloatVec::multiplyAdd(squares, x, x);
+            peaks = FloatVec::max(peaks, FloatVec::max(x, zero - x));
+        }
+
+        sumSquares += squares.sum();
+        for (size_t lane = 0; lane < FloatVec::SIMDNumElements; ++lane)
+            peak = juce::jmax(peak, peaks.get(lane));
+
+        for (; i < numSamples; ++i)
+        {
+            sumSquares += samples[i] * samples[i];
+            peak = juce::jmax(peak, std::abs(samples[i]));
+        }
+    }
+}
+
+void AutoWah::prepare(double newSampleRate, int numChannels)
+{
+    sampleRate = newSampleRate;
+    channels.assign((size_t)juce::jmax(1, numChannels), ChannelState());
+    lfoPhase = 0.0;
+    setFollower(sensitivity, attackSeconds, releaseSeconds);
+    reset();
+}
+
+void AutoWah::reset()
+{
+    for (auto& state : channels)
+        state = ChannelState();
+
+    envelope = sumSquares = peak = 0.0f;
+    current = target = makeCoefficients(getSweep());
+    step = Coefficients();
+    samplesUntilUpdate = 0;
+    skipped = false;
+}
+
+void AutoWah::setParameters(float newFrequency, float newDepth, float newRate)
+{
+    frequency = newFrequency;
+    depth = newDepth;
+    rate = newRate;
+}
+
+void AutoWah::setFollower(float newSensitivity, float newAttackSeconds, float newReleaseSeconds)
+{
+    sensitivity = newSensitivity;
+    attackSeconds = newAttackSeconds;
+    releaseSeconds = newReleaseSeconds;
+
+    // One-pole smoothing, stepped once per interval.
+    auto coefficient = [this](float seconds)
+    {
+        return (float)std::exp(-controlInterval / (juce::jmax(1.0e-4, (double)seconds) * sampleRate));
+    };
+    attackCoefficient = coefficient(attackSeconds);
+    releaseCoefficient = coefficient(releaseSeconds);
+}
+
+void AutoWah::syncToTime(double seconds)
+{
+    const auto hostPhase = rate * seconds - std::floor(rate * seconds);
+    const auto samplesAhead = rate / sampleRate * samplesUntilUpdate;
+    auto difference = std::abs(hostPhase + samplesAhead - lfoPhase);
+    difference -= std::floor(difference);
+    difference = juce::jmin(difference, 1.0 - difference);
+
+    if (difference > 0.01)
+    {
+        lfoPhase = hostPhase + samplesAhead;
+        lfoPhase -= std::floor(lfoPhase);
+    }
+}
+
+void AutoWah::advanceControl()
+{
+    // The LFO keeps running in the follower modes, so switching back doesn't jump.
+    lfoPhase += rate / sampleRate * controlInterval;
+    lfoPhase -= std::floor(lfoPhase);
+
+    if (mode == LfoWah)
+        return;
+
+    const auto channelSamples = (float)(controlInterval * (int)channels.size());
+    const auto level = mode == RmsFollowerWah ? std::sqrt(sumSquares / channelSamples) : peak;
+    const auto coefficient = level > envelope ? attackCoefficient : releaseCoefficient;
+    envelope = level + coefficient * (envelope - level);
+    sumSquares = peak = 0.0f;
+}
+
+double AutoWah::getSweep() const
+{
+    if (mode == LfoWah)
+        return 0.5 * (1.0 + FastMath::sin((float)lfoPhase));
+
+    return juce::jmin(1.0, (double)(envelope * sensitivity));
+}
+
+AutoWah::Coefficients AutoWah::makeCoefficients(double sweep) const
+{
+    const auto cutoff = juce::jmin(frequency * (1.0 + depth * sweep), 0.45 * sampleRate);
+
+    const auto g = std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate);
+    const auto k = 1.0 / q;
+
+    Coefficients coefficients;
+    coefficients.a1 = (float)(1.0 / (1.0 + g * (g + k)));
+    coefficients.a2 = (float)g * coefficients.a1;
+    coefficients.a3 = (float)g * coefficients.a2;
+    return coefficients;
+}
+
+void AutoWah::process(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const int numChannels = juce::jmin(buffer.getNumChannels(), (int)channels.size());
+
+    // Coming back from skip(): hold the current cutoff until the next control point.
+    if (skipped)
+    {
+        current = target = makeCoefficients(getSweep());
+        step = Coefficients();
+        skipped = false;
+    }
+
+    for (int start = 0; start < numSamples;)
+    {
+        if (samplesUntilUpdate == 0)
+        {
+            // Aim for the cutoff at the end of the next interval, so the ramp lands on it.
+            // The LFO only moves in whole intervals, so it doesn't depend on how the
+            // host splits the blocks.
+            advanceControl();
+            target = makeCoefficients(getSweep());
+            step.a1 = (target.a1 - current.a1) / (float)controlInterval;
+            step.a2 = (target.a2 - current.a2) / (float)controlInterval;
+            step.a3 = (target.a3 - current.a3) / (float)controlInterval;
+            samplesUntilUpdate = controlInterval;
+        }
+
+        const int length = juce::jmin(numSamples - start, samplesUntilUpdate);
+        const int offset = controlInterval - samplesUntilUpdate;
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = buffer.getWritePointer(channel, start);
+            if (mode != LfoWah)
+                measure(samples, length, sumSquares, peak);
+            processChannel(samples, length, offset, channels[(size_t)channel]);
+        }
+
+        samplesUntilUpdate -= length;
+        if (samplesUntilUpdate == 0)
+            current = target;
+
+        start += length;
+    }
+}
+
+bool AutoWah::isIdle() const
+{
+    for (const auto& state : channels)
+        if (std::abs(state.ic1eq) > idleThreshold || std::abs(state.ic2eq) > idleThreshold)
+            return false;
+
+    return true;
+}
+
+void AutoWah::skip(int numSamples)
+{
+    // Whatever is left is below the threshold; clearing it makes the restart exact.
+    for (auto& state : channels)
+        state = ChannelState();
+
+    while (numSamples > 0)
+    {
+        if (samplesUntilUpdate == 0)
+        {
+            advanceControl();
+            samplesUntilUpdate = controlInterval;
+        }
+
+        const int length = juce::jmin(numSamples, samplesUntilUpdate);
+        samplesUntilUpdate -= length;
+        numSamples -= length;
+    }
+
+    skipped = true;
+}
+
+double AutoWah::getTailSeconds(float frequency)
+{
+    // The band-pass poles decay with a time constant of 2q / omega at the cutoff; the
+    // lowest cutoff rings longest. ln(10^6) time constants takes it down 120 dB.
+    const auto timeConstant = 2.0 * q / (juce::MathConstants<double>::twoPi * juce::jmax(1.0f, frequency));
+    return std::log(1.0e6) * timeConstant;
+}
+
+void AutoWah::processChannel(float* samples, int numSamples, int offset, ChannelState& state) const
+{
+    auto ic1eq = state.ic1eq;
+    auto ic2eq = state.ic2eq;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // From the interval's start rather than accumulated, so a block boundary
+        // inside the interval gives exactly the same values.
+        const auto position = (float)(offset + i + 1);
+        const auto a1 = current.a1 + step.a1 * position;
+        const auto a2 = current.a2 + step.a2 * position;
+        const auto a3 = current.a3 + step.a3 * position;
+
+        const auto v3 = samples[i] - ic2eq;
+        const auto v1 = a1 * ic1eq + a2 * v3;
+        const auto v2 = ic2eq + a2 * ic1eq + a3 * v3;
+        ic1eq = 2.0f * v1 - ic1eq;
+        ic2eq = 2.0f * v2 - ic2eq;
+
+        // Band-pass scaled by 1 / q for unity gain at the cutoff.
+        samples[i] = v1 / q;
+    }
+
+    state.ic1eq = ic1eq;
+    state.ic2eq = ic2eq;
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    Auto-wah: a topology-preserving-transform state-variable band-pass per
+    channel, swept by a sine LFO or by the level of its input.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+enum AutoWahMode
+{
+    LfoWah = 1,
+    RmsFollowerWah = 2,
+    PeakFollowerWah = 3
+};
+
+// The cutoff is recomputed every controlInterval samples and the filter
+// coefficients are interpolated linearly in between. Control points follow the
+// sample clock rather than the host's blocks, so the sweep is the same at any
+// block size. In the follower modes the level measured over one interval sets the
+// cutoff the next interval ramps to.
+class AutoWah
+{
+public:
+    static constexpr int controlInterval = 32;
+
+    AutoWah() {}
+    ~AutoWah() {}
+
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+
+    // frequency in Hz; the cutoff sweeps from frequency up to frequency * (1 + depth).
+    void setParameters(float frequency, float depth, float rate);
+    void setMode(AutoWahMode newMode) { mode = newMode; }
+    // sensitivity scales the detected level, so the full sweep is reached at 1 / sensitivity.
+    void setFollower(float sensitivity, float attackSeconds, float releaseSeconds);
+    // Follows the host's transport. Small differences from the free-running LFO are
+    // ignored, so the phase only jumps when the host does.
+    void syncToTime(double seconds);
+
+    void process(juce::AudioBuffer<float>& buffer, int numSamples);
+
+    // True once the filter's state has decayed below idleThreshold, so with silent input
+    // its output would be silent too.
+    bool isIdle() const;
+    // Stands in for process() on a silent, idle block: the LFO and follower keep time,
+    // but no samples are touched.
+    void skip(int numSamples);
+    // How long the filter rings after its input stops, for a sweep starting at frequency.
+    static double getTailSeconds(float frequency);
+
+private:
+    struct Coefficients
+    {
+        float a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    };
+
+    struct ChannelState
+    {
+        float ic1eq = 0.0f, ic2eq = 0.0f;
+    };
+
+    static constexpr float q = 1.0f;
+    static constexpr float idleThreshold = 1.0e-6f;    // -120 dB
+
+    // sweep 0-1, from frequency up to the top of the range.
+    Coefficients makeCoefficients(double sweep) const;
+    void advanceControl();
+    double getSweep() const;
+    void processChannel(float* samples, int numSamples, int offset, ChannelState& state) const;
+
+    double sampleRate = 44100.0;
+    float frequency = 700.0f;
+    float depth = 0.8f;
+    float rate = 2.0f;
+    AutoWahMode mode = LfoWah;
+
+    float sensitivity = 4.0f;
+    float attackCoefficient = 0.0f;     // per interval
+    float releaseCoefficient = 0.0f;
+    float attackSeconds = 0.01f;
+    float releaseSeconds = 0.15f;
+    float envelope = 0.0f;
+    float sumSquares = 0.0f;            // over the interval so far, all channels
+    float peak = 0.0f;
+
+    double lfoPhase = 0.0;      // cycles, at the end of the current interval
+    bool skipped = false;       // the coefficients are stale after skip()
+    int samplesUntilUpdate = 0;
+    Coefficients current, target, step;    // current is at the start of the interval
+
+    std::vector<ChannelState> channels;
+};
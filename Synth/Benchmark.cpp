@@ -0,0 +1,776 @@
+#include "Benchmark.h"
+#include <iostream>
+#include <limits>
+#include <vector>
+#include "PluginProcessor.h"
+#include "../Shared/FastMath.h"
+#include "../Shared/PresetBank.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    const int numRepeats = 3;
+
+    struct Timing
+    {
+        double nsPerSample = 0.0;
+        double cyclesPerSample = 0.0;
+    };
+
+#if JUCE_INTEL
+    const bool hasCycleCounter = true;
+    juce::int64 readCycleCounter() { return (juce::int64)__rdtsc(); }
+#else
+    // Cycles are estimated from the nominal clock instead.
+    const bool hasCycleCounter = false;
+    juce::int64 readCycleCounter() { return 0; }
+#endif
+
+    // Best of a few runs, since interference only ever makes a run slower.
+    template <typename Function>
+    Timing measure(juce::int64 samplesPerRun, Function&& run)
+    {
+        Timing best;
+        best.nsPerSample = std::numeric_limits<double>::max();
+
+        for (int repeat = 0; repeat < numRepeats; ++repeat)
+        {
+            const auto startCycles = readCycleCounter();
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            run();
+            const auto ticks = juce::Time::getHighResolutionTicks() - startTicks;
+            const auto cycles = readCycleCounter() - startCycles;
+
+            const auto nsPerSample = juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9 / (double)samplesPerRun;
+            if (nsPerSample < best.nsPerSample)
+            {
+                best.nsPerSample = nsPerSample;
+                best.cyclesPerSample = hasCycleCounter ? (double)cycles / (double)samplesPerRun
+                                                       : nsPerSample * juce::SystemStats::getCpuSpeedInMegahertz() / 1000.0;
+            }
+        }
+
+        return best;
+    }
+
+    // unit names what the timing was divided by, "Sample" unless the run counts something else.
+    juce::var makeResult(const Timing& timing, std::initializer_list<std::pair<const char*, juce::var>> settings,
+                         const juce::String& unit = "Sample")
+    {
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        for (const auto& setting : settings)
+            result->setProperty(setting.first, setting.second);
+        result->setProperty("nsPer" + unit, timing.nsPerSample);
+        result->setProperty("cyclesPer" + unit, timing.cyclesPerSample);
+        return result.get();
+    }
+
+    void setParameter(SynthAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* parameter = processor.parameters.getParameter(parameterID))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    const char* getWaveTypeName(WaveType waveType)
+    {
+        switch (waveType)
+        {
+        case Sine:      return "Sine";
+        case Sawtooth:  return "Sawtooth";
+        case Square:    return "Square";
+        case Triangle:  return "Triangle";
+        }
+        return "";
+    }
+
+    // MIDI only goes to 127, so large voice counts start lower.
+    int getFirstNote(int numVoices)
+    {
+        return juce::jmin(36, 128 - numVoices);
+    }
+
+    // Holds numVoices notes through processBlock, auto-wah after the voices if asked for.
+    Timing benchmarkProcessBlock(SynthAudioProcessor& processor, WaveType waveType, int numVoices, int blockSize,
+                                 double sampleRate, bool autoWah, double seconds)
+    {
+        setParameter(processor, "waveType", (float)(waveType - Sine));
+        setParameter(processor, "autoWah", autoWah ? 1.0f : 0.0f);
+        processor.setMaxVoices(numVoices);
+        processor.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        for (int voice = 0; voice < numVoices; ++voice)
+            midi.addEvent(juce::MidiMessage::noteOn(1, getFirstNote(numVoices) + voice, (juce::uint8)100), 0);
+        processor.processBlock(buffer, midi);
+        midi.clear();
+
+        // Past the attack and decay, so every run times the same sustained voices.
+        const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+        for (int block = 0; block < (int)(0.1 * sampleRate) / blockSize + 1; ++block)
+            processor.processBlock(buffer, midi);
+
+        const auto timing = measure((juce::int64)numBlocks * blockSize, [&]
+        {
+            for (int block = 0; block < numBlocks; ++block)
+                processor.processBlock(buffer, midi);
+        });
+
+        processor.releaseResources();
+        return timing;
+    }
+
+    juce::var benchmarkSynth(double seconds)
+    {
+        juce::Array<juce::var> results;
+        SynthAudioProcessor processor;
+
+        for (auto sampleRate : { 44100.0, 96000.0 })
+            for (int blockSize = 32; blockSize <= 4096; blockSize *= 2)
+                for (int numVoices : { 1, 16, 64, 128 })
+                    for (auto waveType : { Sine, Sawtooth, Square, Triangle })
+                        for (bool autoWah : { false, true })
+                        {
+                            const auto timing = benchmarkProcessBlock(processor, waveType, numVoices, blockSize, sampleRate, autoWah, seconds);
+                            results.add(makeResult(timing, { { "waveType", getWaveTypeName(waveType) }, { "voices", numVoices },
+                                                             { "blockSize", blockSize }, { "sampleRate", sampleRate },
+                                                             { "autoWah", autoWah } }));
+                        }
+
+        return results;
+    }
+
+    // Per voice at full gain, after voiceBankCheckLength samples, as stated when the bank
+    // replaced the double render. The benchmark's gains sum to 1, so it bounds the mix too.
+    const double voiceBankTolerance = 2.0e-4;
+    const int voiceBankCheckLength = 2048;
+    // The bank's phase is 32-bit fixed point and the reference's a double, so right at a
+    // sawtooth or square edge the two can land either side of it.
+    const double edgeCycles = 1.0e-6;
+
+    // The per-Voice render the bank replaced: one voice after another, a sample at a time,
+    // in double radians. The volume is held rather than re-read from the millisecond clock
+    // every sample, so this is the cheaper side of the old loop. The triangle folds with
+    // 2 - x, as intended, not the old 3 - x.
+    struct ReferenceVoice
+    {
+        double angle = 0.0, angleDelta = 0.0, volume = 0.0;
+    };
+
+    double getReferenceSample(WaveType waveType, double angle, double pulseWidth)
+    {
+        const auto pi = juce::MathConstants<double>::pi;
+        double sample = 0.0;
+        switch (waveType)
+        {
+        case Sine:
+            sample = std::sin(angle);
+            break;
+        case Sawtooth:
+            sample = angle / pi;
+            sample = sample < 1.0 ? sample : sample - 2.0;
+            break;
+        case Square:
+            sample = angle < juce::MathConstants<double>::twoPi * pulseWidth ? 1.0 : -1.0;
+            break;
+        case Triangle:
+            sample = 2.0 * angle / pi;
+            if (sample > 1.0)
+                sample = sample < 3.0 ? 2.0 - sample : sample - 4.0;
+            break;
+        }
+        return sample;
+    }
+
+    bool isNearEdge(WaveType waveType, double angle, double pulseWidth)
+    {
+        const auto cycles = angle / juce::MathConstants<double>::twoPi;
+        auto near = [&](double edge) { return std::abs(cycles - edge) < edgeCycles; };
+
+        switch (waveType)
+        {
+        case Sawtooth:  return near(0.5);
+        case Square:    return near(0.0) || near(1.0) || near(pulseWidth);
+        case Sine:
+        case Triangle:
+        default:        return false;
+        }
+    }
+
+    void renderReference(std::vector<ReferenceVoice>& voices, float* output, int numSamples, WaveType waveType, double pulseWidth)
+    {
+        const auto twoPi = juce::MathConstants<double>::twoPi;
+        for (auto& voice : voices)
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto sample = getReferenceSample(waveType, voice.angle, pulseWidth);
+                voice.angle += voice.angleDelta;
+                if (voice.angle >= twoPi)
+                    voice.angle -= twoPi;
+                output[i] += (float)(sample * voice.volume);
+            }
+    }
+
+    // numVoices sustained naive-shape notes on a VoiceBank, on the calling thread only, and
+    // the same notes through the reference, both mono. Sustain is held at 1 from the first
+    // sample, so the two start together and can be compared sample for sample.
+    void startVoiceBankNotes(VoiceBank& bank, std::vector<ReferenceVoice>& voices, int numVoices, double sampleRate, int blockSize)
+    {
+        AdsrEnvelope::Parameters parameters;
+        parameters.attack = 0.0;
+        parameters.decay = 0.0;
+        parameters.sustain = 1.0;
+
+        bank.prepare(numVoices, sampleRate, blockSize);
+        bank.setEnvelopeParameters(parameters);
+        voices.assign((size_t)numVoices, {});
+
+        for (int voice = 0; voice < numVoices; ++voice)
+        {
+            const auto frequency = juce::MidiMessage::getMidiNoteInHertz(getFirstNote(numVoices) + voice);
+            const auto cyclesPerSample = (float)(frequency / sampleRate);
+            const auto gain = 1.0f / (float)numVoices;
+
+            bank.setIncrement(voice, cyclesPerSample);
+            bank.setGain(voice, gain);
+            bank.noteOn(voice);
+            voices[(size_t)voice].angleDelta = (double)cyclesPerSample * juce::MathConstants<double>::twoPi;
+            voices[(size_t)voice].volume = (double)gain;
+        }
+    }
+
+    // The largest difference between the mixes, leaving out samples where any voice is at an edge.
+    double measureVoiceBankError(int numVoices, WaveType waveType, double sampleRate, double pulseWidth)
+    {
+        VoiceBank bank;
+        std::vector<ReferenceVoice> voices;
+        startVoiceBankNotes(bank, voices, numVoices, sampleRate, 512);
+
+        std::vector<float> bankMix((size_t)voiceBankCheckLength, 0.0f), referenceMix((size_t)voiceBankCheckLength, 0.0f);
+        std::vector<uint8_t> atEdge((size_t)voiceBankCheckLength, 0);
+        bank.render(bankMix.data(), nullptr, voiceBankCheckLength, waveType, (float)pulseWidth, false);
+
+        for (auto voice : voices)
+            for (int i = 0; i < voiceBankCheckLength; ++i)
+            {
+                atEdge[(size_t)i] |= isNearEdge(waveType, voice.angle, pulseWidth) ? 1 : 0;
+                voice.angle += voice.angleDelta;
+                if (voice.angle >= juce::MathConstants<double>::twoPi)
+                    voice.angle -= juce::MathConstants<double>::twoPi;
+            }
+        renderReference(voices, referenceMix.data(), voiceBankCheckLength, waveType, pulseWidth);
+
+        double maxError = 0.0;
+        for (int i = 0; i < voiceBankCheckLength; ++i)
+            if (atEdge[(size_t)i] == 0)
+                maxError = juce::jmax(maxError, (double)std::abs(bankMix[(size_t)i] - referenceMix[(size_t)i]));
+        return maxError;
+    }
+
+    // The bank against the scalar render it replaced, on one thread, so the speedup is the
+    // bank's own and not the render pool's.
+    juce::var benchmarkVoiceBank(double seconds, bool& withinTolerance)
+    {
+        const double sampleRate = 48000.0;
+        const int blockSize = 512;
+        const double pulseWidth = 0.3;
+        const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+        juce::Array<juce::var> results;
+        std::vector<float> mix((size_t)blockSize);
+        withinTolerance = true;
+
+        for (int numVoices : { 16, 64, 128 })
+            for (auto waveType : { Sine, Sawtooth, Square, Triangle })
+            {
+                VoiceBank bank;
+                std::vector<ReferenceVoice> voices;
+                startVoiceBankNotes(bank, voices, numVoices, sampleRate, blockSize);
+
+                const auto bankTiming = measure((juce::int64)numBlocks * blockSize, [&]
+                {
+                    for (int block = 0; block < numBlocks; ++block)
+                    {
+                        juce::FloatVectorOperations::clear(mix.data(), blockSize);
+                        bank.render(mix.data(), nullptr, blockSize, waveType, (float)pulseWidth, false);
+                    }
+                });
+                const auto referenceTiming = measure((juce::int64)numBlocks * blockSize, [&]
+                {
+                    for (int block = 0; block < numBlocks; ++block)
+                    {
+                        juce::FloatVectorOperations::clear(mix.data(), blockSize);
+                        renderReference(voices, mix.data(), blockSize, waveType, pulseWidth);
+                    }
+                });
+
+                const auto maxError = measureVoiceBankError(numVoices, waveType, sampleRate, pulseWidth);
+                withinTolerance = withinTolerance && maxError <= voiceBankTolerance;
+
+                auto result = makeResult(bankTiming, { { "waveType", getWaveTypeName(waveType) }, { "voices", numVoices },
+                                                       { "blockSize", blockSize }, { "sampleRate", sampleRate } });
+                auto* object = result.getDynamicObject();
+                object->setProperty("referenceNsPerSample", referenceTiming.nsPerSample);
+                object->setProperty("referenceCyclesPerSample", referenceTiming.cyclesPerSample);
+                object->setProperty("speedup", bankTiming.nsPerSample > 0.0 ? referenceTiming.nsPerSample / bankTiming.nsPerSample : 0.0);
+                object->setProperty("maxError", maxError);
+                object->setProperty("tolerance", voiceBankTolerance);
+                results.add(result);
+            }
+
+        return results;
+    }
+
+    // A note-on and a note-off per event, with the bank full so every policy steals.
+    juce::var benchmarkAllocator()
+    {
+        const int numEvents = 1 << 20;
+        juce::Array<juce::var> results;
+
+        for (int numVoices : { 1, 16, 64 })
+            for (auto policy : { StealOldest, StealQuietest, StealSameNote })
+            {
+                VoiceAllocator allocator;
+                allocator.setMaxVoices(numVoices);
+                allocator.setStealingPolicy(policy);
+
+                const auto timing = measure(numEvents, [&]
+                {
+                    for (int i = 0; i < numEvents; ++i)
+                    {
+                        // A fresh StealQuietest pick every 32 events, as the synth gives one per block.
+                        if ((i & 31) == 0)
+                            allocator.setQuietestVoice((i * 37) % numVoices);
+                        allocator.noteOn((i * 7) & 127);
+                        const auto released = allocator.noteOff(((i - numVoices) * 7) & 127);
+                        if (released != VoiceAllocator::noVoice && (i & 1) != 0)
+                            allocator.voiceFinished(released);
+                    }
+                });
+
+                results.add(makeResult(timing, { { "voices", numVoices }, { "stealing", (int)policy } }, "Event"));
+            }
+
+        return results;
+    }
+
+    // Each mode starts from the same stereo noise, so the follower modes differ from
+    // the LFO only by the detector.
+    juce::var benchmarkAutoWah(double seconds, double detectorLimit, bool& withinLimit)
+    {
+        const double sampleRate = 48000.0;
+        juce::Array<juce::var> results;
+        double worstOverhead = 0.0;
+
+        for (int blockSize : { 32, 256, 4096 })
+        {
+            juce::AudioBuffer<float> noise(2, blockSize), buffer(2, blockSize);
+            juce::Random random(1);
+            for (int channel = 0; channel < 2; ++channel)
+                for (int i = 0; i < blockSize; ++i)
+                    noise.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+            const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+            double lfoNanoseconds = 0.0;
+
+            for (auto mode : { LfoWah, RmsFollowerWah, PeakFollowerWah })
+            {
+                buffer.makeCopyOf(noise);
+                AutoWah autoWah;
+                autoWah.setMode(mode);
+                autoWah.prepare(sampleRate, 2);
+
+                const auto timing = measure((juce::int64)numBlocks * blockSize, [&]
+                {
+                    for (int block = 0; block < numBlocks; ++block)
+                        autoWah.process(buffer, blockSize);
+                });
+
+                if (mode == LfoWah)
+                    lfoNanoseconds = timing.nsPerSample;
+                else
+                    worstOverhead = juce::jmax(worstOverhead, timing.nsPerSample / lfoNanoseconds - 1.0);
+
+                results.add(makeResult(timing, { { "mode", (int)mode }, { "blockSize", blockSize }, { "sampleRate", sampleRate } }));
+            }
+        }
+
+        withinLimit = worstOverhead <= detectorLimit;
+
+        juce::DynamicObject::Ptr autoWah = new juce::DynamicObject();
+        autoWah->setProperty("results", results);
+        autoWah->setProperty("detectorOverhead", worstOverhead);
+        autoWah->setProperty("detectorLimit", detectorLimit);
+        autoWah->setProperty("withinLimit", withinLimit);
+        return autoWah.get();
+    }
+
+    // A supersaw note at each unison count against the same count of plain voices, so the
+    // cost of one more unison oscillator reads as a fraction of the cost of one more voice.
+    juce::var benchmarkUnison(double seconds)
+    {
+        const double sampleRate = 48000.0;
+        const int blockSize = 512;
+        const int counts[] = { 1, 2, 4, 8, VoiceBank::maxUnison };
+        juce::Array<juce::var> results;
+        double unisonNanoseconds[5] = {}, voiceNanoseconds[5] = {};
+
+        SynthAudioProcessor processor;
+        setParameter(processor, "unisonDetune", 20.0f);
+        setParameter(processor, "unisonSpread", 0.5f);
+        setParameter(processor, "stereoSpread", 0.5f);
+
+        for (int i = 0; i < 5; ++i)
+        {
+            setParameter(processor, "unisonVoices", (float)counts[i]);
+            const auto unison = benchmarkProcessBlock(processor, Sawtooth, 1, blockSize, sampleRate, false, seconds);
+            unisonNanoseconds[i] = unison.nsPerSample;
+            results.add(makeResult(unison, { { "unison", counts[i] }, { "voices", 1 }, { "blockSize", blockSize }, { "sampleRate", sampleRate } }));
+
+            setParameter(processor, "unisonVoices", 1.0f);
+            const auto voices = benchmarkProcessBlock(processor, Sawtooth, counts[i], blockSize, sampleRate, false, seconds);
+            voiceNanoseconds[i] = voices.nsPerSample;
+            results.add(makeResult(voices, { { "unison", 1 }, { "voices", counts[i] }, { "blockSize", blockSize }, { "sampleRate", sampleRate } }));
+        }
+
+        const auto added = (double)(VoiceBank::maxUnison - 1);
+        const auto perOscillator = (unisonNanoseconds[4] - unisonNanoseconds[0]) / added;
+        const auto perVoice = (voiceNanoseconds[4] - voiceNanoseconds[0]) / added;
+
+        juce::DynamicObject::Ptr unison = new juce::DynamicObject();
+        unison->setProperty("results", results);
+        unison->setProperty("nsPerUnisonOscillator", perOscillator);
+        unison->setProperty("nsPerVoice", perVoice);
+        unison->setProperty("unisonOscillatorPerVoice", perVoice > 0.0 ? perOscillator / perVoice : 0.0);
+        return unison.get();
+    }
+
+    // Worst error over a sweep of the kernel's documented range, against double precision.
+    template <typename Kernel, typename Reference>
+    double measureError(Kernel&& kernel, Reference&& reference, double low, double high, bool relative)
+    {
+        const int numValues = 1 << 16;
+        std::vector<float> source((size_t)numValues), result((size_t)numValues);
+        double worst = 0.0;
+
+        for (int start = 0; start < 16; ++start)
+        {
+            for (int i = 0; i < numValues; ++i)
+                source[(size_t)i] = (float)(low + (high - low) * ((double)i * 16 + start) / ((double)numValues * 16));
+            kernel(result.data(), source.data(), numValues);
+
+            for (int i = 0; i < numValues; ++i)
+            {
+                const auto expected = reference((double)source[(size_t)i]);
+                const auto error = std::abs((double)result[(size_t)i] - expected);
+                worst = juce::jmax(worst, relative ? error / std::abs(expected) : error);
+            }
+        }
+
+        return worst;
+    }
+
+    // The kernels' error bounds, and their speed next to the standard library a block at a time.
+    juce::var benchmarkFastMath(double seconds, bool& withinBounds)
+    {
+        const auto twoPi = juce::MathConstants<double>::twoPi;
+        struct Accuracy
+        {
+            const char* kernel;
+            double error, bound;
+        };
+
+        const Accuracy accuracy[] = {
+            { "sin", measureError([](float* d, const float* s, int n) { FastMath::sin(d, s, n); },
+                                  [=](double x) { return std::sin(twoPi * x); }, -1024.0, 1024.0, false), FastMath::sinMaxError },
+            { "cos", measureError([](float* d, const float* s, int n) { FastMath::cos(d, s, n); },
+                                  [=](double x) { return std::cos(twoPi * x); }, -1024.0, 1024.0, false), FastMath::sinMaxError },
+            { "exp2", measureError([](float* d, const float* s, int n) { FastMath::exp2(d, s, n); },
+                                   [](double x) { return std::exp2(x); }, -126.0, 126.0, true), FastMath::exp2MaxRelativeError },
+            { "noteToFrequency", measureError([](float* d, const float* s, int n) { FastMath::noteToFrequency(d, s, n); },
+                                              [](double x) { return 440.0 * std::exp2((x - 69.0) / 12.0); }, 0.0, 127.0, true),
+              FastMath::conversionMaxRelativeError },
+            { "decibelsToGain", measureError([](float* d, const float* s, int n) { FastMath::decibelsToGain(d, s, n); },
+                                             [](double x) { return std::pow(10.0, x / 20.0); }, -99.0, 24.0, true),
+              FastMath::conversionMaxRelativeError },
+        };
+
+        juce::Array<juce::var> accuracyResults;
+        withinBounds = true;
+        for (const auto& entry : accuracy)
+        {
+            juce::DynamicObject::Ptr result = new juce::DynamicObject();
+            result->setProperty("kernel", entry.kernel);
+            result->setProperty("maxError", entry.error);
+            result->setProperty("bound", entry.bound);
+            accuracyResults.add(result.get());
+            withinBounds = withinBounds && entry.error <= entry.bound;
+        }
+
+        // LFO-sized blocks of phases, as the plugins use them.
+        const int blockSize = 512;
+        const int numBlocks = juce::jmax(1, (int)(seconds * 48000.0) / blockSize);
+        std::vector<float> phases((size_t)blockSize), values((size_t)blockSize);
+        for (int i = 0; i < blockSize; ++i)
+            phases[(size_t)i] = (float)i / (float)blockSize;
+
+        auto time = [&](auto&& kernel)
+        {
+            return measure((juce::int64)numBlocks * blockSize, [&]
+            {
+                for (int block = 0; block < numBlocks; ++block)
+                    kernel(values.data(), phases.data(), blockSize);
+            });
+        };
+
+        const auto fastSin = time([](float* d, const float* s, int n) { FastMath::sin(d, s, n); });
+        const auto stdSin = time([](float* d, const float* s, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                d[i] = std::sin(juce::MathConstants<float>::twoPi * s[i]);
+        });
+        const auto fastExp2 = time([](float* d, const float* s, int n) { FastMath::exp2(d, s, n); });
+        const auto stdExp2 = time([](float* d, const float* s, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                d[i] = std::exp2(s[i]);
+        });
+
+        juce::Array<juce::var> speedResults;
+        speedResults.add(makeResult(fastSin, { { "kernel", "FastMath::sin" }, { "blockSize", blockSize } }, "Value"));
+        speedResults.add(makeResult(stdSin, { { "kernel", "std::sin" }, { "blockSize", blockSize } }, "Value"));
+        speedResults.add(makeResult(fastExp2, { { "kernel", "FastMath::exp2" }, { "blockSize", blockSize } }, "Value"));
+        speedResults.add(makeResult(stdExp2, { { "kernel", "std::exp2" }, { "blockSize", blockSize } }, "Value"));
+
+        juce::DynamicObject::Ptr fastMath = new juce::DynamicObject();
+        fastMath->setProperty("accuracy", accuracyResults);
+        fastMath->setProperty("speed", speedResults);
+        fastMath->setProperty("sinSpeedup", stdSin.nsPerSample / fastSin.nsPerSample);
+        fastMath->setProperty("exp2Speedup", stdExp2.nsPerSample / fastExp2.nsPerSample);
+        fastMath->setProperty("withinBounds", withinBounds);
+        return fastMath.get();
+    }
+
+    // A bank of numPresets copies of the default state under distinct names: opening it,
+    // looking every name up, a search that reads every name, and loading states from it.
+    juce::var benchmarkPresetBank()
+    {
+        const int numPresets = 4096;
+        SynthAudioProcessor processor;
+        juce::MemoryBlock state;
+        processor.getStateInformation(state);
+
+        std::vector<PresetBank::Preset> presets((size_t)numPresets);
+        for (int i = 0; i < numPresets; ++i)
+        {
+            presets[(size_t)i].name = "Preset " + juce::String(i * 7919 % numPresets).paddedLeft('0', 4);
+            presets[(size_t)i].state = state;
+        }
+
+        juce::TemporaryFile bankFile(".presets");
+        if (!PresetBank::write(bankFile.getFile(), SynthAudioProcessor::stateTag, presets))
+            juce::ConsoleApplication::fail("Couldn't write a preset bank to " + bankFile.getFile().getFullPathName());
+
+        const auto open = measure(numPresets, [&]
+        {
+            const PresetBank bank(bankFile.getFile(), SynthAudioProcessor::stateTag);
+            jassert(bank.size() == numPresets);
+        });
+
+        const PresetBank bank(bankFile.getFile(), SynthAudioProcessor::stateTag);
+        int found = 0;
+        const auto lookup = measure(numPresets, [&]
+        {
+            for (const auto& preset : presets)
+                found += bank.indexOf(preset.name) >= 0 ? 1 : 0;
+        });
+        const auto search = measure(numPresets, [&] { found += (int)bank.search("PRESET 40").size(); });
+        const auto load = measure(numPresets / 64, [&]
+        {
+            for (int i = 0; i < numPresets / 64; ++i)
+                processor.setStateInformation(bank.getStateData(i), bank.getStateSize(i));
+        });
+        juce::ignoreUnused(found);
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty("presets", numPresets);
+        result->setProperty("stateBytes", (int)state.getSize());
+        result->setProperty("open", makeResult(open, {}, "Preset"));
+        result->setProperty("indexOf", makeResult(lookup, {}, "Lookup"));
+        result->setProperty("search", makeResult(search, {}, "Preset"));
+        result->setProperty("setState", makeResult(load, {}, "Preset"));
+        return result.get();
+    }
+
+    // Held notes through a program change in every block, against the same blocks with none.
+    // Each switch lands mid-block on its event's sample: the voices are copied to the fade bank,
+    // the new patch is applied, and both banks render through the programFadeSeconds crossfade,
+    // which ends within the block.
+    juce::var benchmarkProgramChange(double seconds)
+    {
+        const double sampleRate = 48000.0;
+        const int blockSize = 512;
+        const int numVoices = 16;
+        const int numPrograms = SynthAudioProcessor::maxPrograms;
+
+        std::vector<PresetBank::Preset> presets((size_t)numPrograms);
+        for (int i = 0; i < numPrograms; ++i)
+        {
+            SynthAudioProcessor source;
+            setParameter(source, "waveType", (float)(i % 4));
+            setParameter(source, "unisonVoices", (float)(1 + i % 3));
+            setParameter(source, "release", 0.01f + 0.01f * (float)(i % 16));
+            presets[(size_t)i].name = "Program " + juce::String(i).paddedLeft('0', 3);
+            source.getStateInformation(presets[(size_t)i].state);
+        }
+
+        juce::TemporaryFile bankFile(".presets");
+        if (!PresetBank::write(bankFile.getFile(), SynthAudioProcessor::stateTag, presets))
+            juce::ConsoleApplication::fail("Couldn't write a preset bank to " + bankFile.getFile().getFullPathName());
+
+        SynthAudioProcessor processor;
+        const auto loaded = processor.loadPrograms(PresetBank(bankFile.getFile(), SynthAudioProcessor::stateTag));
+        processor.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        for (int voice = 0; voice < numVoices; ++voice)
+            midi.addEvent(juce::MidiMessage::noteOn(1, 48 + voice, (juce::uint8)100), 0);
+        processor.processBlock(buffer, midi);
+        midi.clear();
+
+        const int numBlocks = juce::jmax(1, (int)(seconds * sampleRate) / blockSize);
+        const auto steady = measure(numBlocks, [&]
+        {
+            for (int block = 0; block < numBlocks; ++block)
+                processor.processBlock(buffer, midi);
+        });
+
+        int program = 0;
+        const auto switching = measure(numBlocks, [&]
+        {
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                program = (program + 1) % juce::jmax(1, loaded);
+                midi.clear();
+                midi.addEvent(juce::MidiMessage::programChange(1, program), blockSize / 2);
+                processor.processBlock(buffer, midi);
+            }
+        });
+        processor.releaseResources();
+
+        Timing perSwitch;
+        perSwitch.nsPerSample = switching.nsPerSample - steady.nsPerSample;
+        perSwitch.cyclesPerSample = switching.cyclesPerSample - steady.cyclesPerSample;
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty("programs", loaded);
+        result->setProperty("voices", numVoices);
+        result->setProperty("blockSize", blockSize);
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("steady", makeResult(steady, {}, "Block"));
+        result->setProperty("switchEveryBlock", makeResult(switching, {}, "Block"));
+        // Negative when the difference is lost in the noise.
+        result->setProperty("switch", makeResult(perSwitch, {}, "Switch"));
+        return result.get();
+    }
+
+    // Enough voices for the threaded path, rendered on the caller alone and then with workers.
+    juce::var benchmarkRenderThreads(int numThreads, double seconds)
+    {
+        const double sampleRate = 48000.0;
+        const int blockSize = 512;
+        const int numVoices = 64;
+        juce::Array<juce::var> results;
+        double singleThreadedNanoseconds = 0.0;
+
+        for (int threads : { 0, numThreads })
+        {
+            SynthAudioProcessor processor;
+            processor.setRenderThreads(threads);
+            const auto timing = benchmarkProcessBlock(processor, Sawtooth, numVoices, blockSize, sampleRate, false, seconds);
+            if (threads == 0)
+                singleThreadedNanoseconds = timing.nsPerSample;
+
+            auto result = makeResult(timing, { { "threads", threads }, { "voices", numVoices }, { "blockSize", blockSize },
+                                               { "sampleRate", sampleRate } });
+            // The speedup is against the same voices rendered on the audio thread alone;
+            // the pool's own figure is only how many threads were busy on average.
+            result.getDynamicObject()->setProperty("speedup", singleThreadedNanoseconds / timing.nsPerSample);
+            result.getDynamicObject()->setProperty("parallelism", processor.getRenderParallelism());
+            result.getDynamicObject()->setProperty("dispatchMicroseconds", processor.getRenderDispatchMicroseconds());
+            result.getDynamicObject()->setProperty("lateRounds", processor.getRenderLateRounds());
+            results.add(result);
+
+            if (numThreads == 0)
+                break;
+        }
+
+        return results;
+    }
+}
+
+void runBenchmarks(const juce::ArgumentList& args)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    const auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 0.25;
+    const auto detectorLimit = args.containsOption("--detector-limit") ? args.getValueForOption("--detector-limit").getDoubleValue() : 0.2;
+    const auto numThreads = args.containsOption("--threads|-t")
+                                ? args.getValueForOption("--threads|-t").getIntValue()
+                                : juce::jlimit(0, 3, juce::SystemStats::getNumCpus() - 1);
+    if (seconds <= 0.0)
+        juce::ConsoleApplication::fail("--seconds must be more than 0");
+
+    juce::DynamicObject::Ptr machine = new juce::DynamicObject();
+    machine->setProperty("cpu", juce::SystemStats::getCpuModel());
+    machine->setProperty("cpus", juce::SystemStats::getNumCpus());
+    machine->setProperty("mhz", juce::SystemStats::getCpuSpeedInMegahertz());
+    machine->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    machine->setProperty("simdLanes", VoiceBank::laneWidth);
+    machine->setProperty("cycleCounter", hasCycleCounter ? "tsc" : "estimated");
+
+    bool detectorWithinLimit = true;
+    bool fastMathWithinBounds = true;
+    bool voiceBankWithinTolerance = true;
+    juce::DynamicObject::Ptr report = new juce::DynamicObject();
+    report->setProperty("machine", machine.get());
+    report->setProperty("repeats", numRepeats);
+    report->setProperty("secondsPerRun", seconds);
+    report->setProperty("processBlock", benchmarkSynth(seconds));
+    report->setProperty("voiceBank", benchmarkVoiceBank(seconds, voiceBankWithinTolerance));
+    report->setProperty("allocator", benchmarkAllocator());
+    report->setProperty("unison", benchmarkUnison(seconds));
+    report->setProperty("autoWah", benchmarkAutoWah(seconds, detectorLimit, detectorWithinLimit));
+    report->setProperty("fastMath", benchmarkFastMath(seconds, fastMathWithinBounds));
+    report->setProperty("presetBank", benchmarkPresetBank());
+    report->setProperty("programChange", benchmarkProgramChange(seconds));
+    report->setProperty("renderThreads", benchmarkRenderThreads(juce::jlimit(0, RenderThreadPool::maxThreads, numThreads), seconds));
+
+    const auto json = juce::JSON::toString(report.get());
+    if (args.containsOption("--json"))
+    {
+        const auto file = args.getFileForOption("--json");
+        if (!file.replaceWithText(json))
+            juce::ConsoleApplication::fail("Couldn't write " + file.getFullPathName());
+    }
+    else
+    {
+        std::cout << json << std::endl;
+    }
+
+    if (!detectorWithinLimit)
+        juce::ConsoleApplication::fail("The auto-wah envelope detector is over its share of the block cost");
+    if (!fastMathWithinBounds)
+        juce::ConsoleApplication::fail("A FastMath kernel is outside its documented error bound");
+    if (!voiceBankWithinTolerance)
+        juce::ConsoleApplication::fail("The voice bank's output differs from the scalar reference by more than its tolerance");
+}
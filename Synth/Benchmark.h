@@ -0,0 +1,19 @@
+/*
+  ==============================================================================
+
+    Microbenchmarks for the synth's render, unison, note allocation and
+    auto-wah paths, the shared FastMath kernels, the preset bank and program
+    changes, reported as JSON so runs on the same machine can be compared.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Runs the benchmarks and prints the JSON, or writes it to --json. Fails the command
+// when the auto-wah's envelope detector costs more than --detector-limit of the block,
+// when a FastMath kernel is outside its documented error bound, or when the voice bank's
+// output strays from the scalar per-voice render by more than its stated tolerance.
+void runBenchmarks(const juce::ArgumentList& args);
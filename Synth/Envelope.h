@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    Sample-clock ADSR envelope. Every segment is a single multiply-add per
+    sample, level = level * multiplier + offset, so a whole segment can be
+    stepped for many voices at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <limits>
+
+enum EnvelopeCurve
+{
+    LinearCurve = 1,
+    ExponentialCurve = 2
+};
+
+struct EnvelopeSegment
+{
+    float multiplier = 1.0f;
+    float offset = 0.0f;
+    float target = 0.0f;    // level is snapped to this once length samples have run
+    int length = 0;
+};
+
+class AdsrEnvelope
+{
+public:
+    enum Stage
+    {
+        Idle = 0,
+        Attack = 1,
+        Decay = 2,
+        Sustain = 3,
+        Release = 4,
+        FastRelease = 5     // short fade for stolen voices
+    };
+
+    struct Parameters
+    {
+        double attack = 0.02;   //seconds
+        double decay = 0.04;    //seconds
+        double sustain = 0.7;   //0-1
+        double release = 0.03;  //seconds
+        EnvelopeCurve curve = LinearCurve;
+
+        bool operator==(const Parameters& other) const
+        {
+            return attack == other.attack && decay == other.decay && sustain == other.sustain
+                && release == other.release && curve == other.curve;
+        }
+    };
+
+    void setSampleRate(double newSampleRate) { sampleRate = newSampleRate; }
+    void setParameters(const Parameters& newParameters) { parameters = newParameters; }
+    const Parameters& getParameters() const { return parameters; }
+
+    static constexpr int sustainLength = std::numeric_limits<int>::max();
+    // How long a stolen voice takes to fade out.
+    static double getFastReleaseSeconds() { return fastReleaseSeconds; }
+
+    static Stage getNextStage(Stage stage)
+    {
+        switch (stage)
+        {
+        case Attack:        return Decay;
+        case Decay:         return Sustain;
+        case Sustain:       return Sustain;
+        case Release:
+        case FastRelease:
+        case Idle:
+        default:            return Idle;
+        }
+    }
+
+    // The segment that runs stage from startLevel. Sustain never ends by itself;
+    // it glides towards the sustain level so that moving the knob doesn't click.
+    EnvelopeSegment getSegment(Stage stage, float startLevel) const
+    {
+        const auto sustainLevel = (float)parameters.sustain;
+
+        switch (stage)
+        {
+        case Attack:
+            // Retriggering from a non-zero level keeps the attack rate, not its duration.
+            return makeSegment(startLevel, 1.0f, toSamples(parameters.attack * (1.0f - startLevel)));
+        case Decay:
+            return makeSegment(startLevel, sustainLevel, toSamples(parameters.decay));
+        case Sustain:
+        {
+            auto segment = makeExponential(startLevel, sustainLevel, toSamples(sustainGlideSeconds));
+            segment.length = sustainLength;
+            return segment;
+        }
+        case Release:
+            return makeSegment(startLevel, 0.0f, toSamples(parameters.release));
+        case FastRelease:
+            return makeLinear(startLevel, 0.0f, toSamples(fastReleaseSeconds));
+        case Idle:
+        default:
+            return { 0.0f, 0.0f, 0.0f, sustainLength };
+        }
+    }
+
+    static EnvelopeSegment makeLinear(float from, float to, int length)
+    {
+        if (length <= 0)
+            return { 1.0f, 0.0f, to, 0 };
+
+        return { 1.0f, (to - from) / (float)length, to, length };
+    }
+
+    // Approaches the target geometrically, reaching exponentialFloor of the
+    // distance after length samples, where the level is then snapped.
+    static EnvelopeSegment makeExponential(float from, float to, int length)
+    {
+        juce::ignoreUnused(from);
+        if (length <= 0)
+            return { 1.0f, 0.0f, to, 0 };
+
+        const auto multiplier = (float)std::pow(exponentialFloor, 1.0 / length);
+        return { multiplier, (1.0f - multiplier) * to, to, length };
+    }
+
+private:
+    EnvelopeSegment makeSegment(float from, float to, int length) const
+    {
+        return parameters.curve == ExponentialCurve ? makeExponential(from, to, length)
+                                                      : makeLinear(from, to, length);
+    }
+
+    int toSamples(double seconds) const { return juce::jmax(0, juce::roundToInt(seconds * sampleRate)); }
+
+    static constexpr double exponentialFloor = 0.001;    // -60 dB
+    static constexpr double sustainGlideSeconds = 0.005;
+    static constexpr double fastReleaseSeconds = 0.003;
+
+    double sampleRate = 44100.0;
+    Parameters parameters;
+};
@@ -0,0 +1,214 @@
+/*
+  ==============================================================================
+
+    Command-line entry point for rendering the synth outside a host. It is
+    built as a console target from the plugin's sources, with the same
+    JucePlugin_* settings as the plugin.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "Benchmark.h"
+#include "PluginProcessor.h"
+#include "../Shared/PresetBank.h"
+#include "../Shared/RealtimeSafety.h"
+
+namespace
+{
+    // Renders a Standard MIDI File through SynthAudioProcessor as fast as it will go.
+    // Only processBlock is timed, so the realtime factor doesn't include writing the file.
+    void renderMidiFile(const juce::ArgumentList& args)
+    {
+        const auto midiFile = args.getExistingFileForOption("--midi|-m");
+        const auto outputFile = args.getFileForOption("--output|-o");
+        const auto sampleRate = args.containsOption("--rate|-r") ? args.getValueForOption("--rate|-r").getDoubleValue() : 48000.0;
+        const auto blockSize = args.containsOption("--block|-b") ? args.getValueForOption("--block|-b").getIntValue() : 512;
+        const auto bitDepth = args.containsOption("--bits") ? args.getValueForOption("--bits").getIntValue() : 24;
+        const auto tailSeconds = args.containsOption("--tail") ? args.getValueForOption("--tail").getDoubleValue() : 2.0;
+
+        if (sampleRate < 8000.0 || sampleRate > 384000.0)
+            juce::ConsoleApplication::fail("Sample rate must be between 8000 and 384000 Hz");
+        if (blockSize < 1 || blockSize > 65536)
+            juce::ConsoleApplication::fail("Block size must be between 1 and 65536 samples");
+        if (bitDepth != 16 && bitDepth != 24 && bitDepth != 32)
+            juce::ConsoleApplication::fail("Bit depth must be 16, 24 or 32");
+
+        juce::MidiFile midi;
+        {
+            juce::FileInputStream stream(midiFile);
+            if (!stream.openedOk() || !midi.readFrom(stream))
+                juce::ConsoleApplication::fail("Couldn't read a MIDI file from " + midiFile.getFullPathName());
+        }
+        midi.convertTimestampTicksToSeconds();
+
+        // Every track onto one timeline, in time order.
+        juce::MidiMessageSequence sequence;
+        for (int track = 0; track < midi.getNumTracks(); ++track)
+            sequence.addSequence(*midi.getTrack(track), 0.0);
+
+        SynthAudioProcessor processor;
+        if (args.containsOption("--state|-s"))
+        {
+            juce::MemoryBlock state;
+            const auto stateFile = args.getExistingFileForOption("--state|-s");
+            if (!stateFile.loadFileAsData(state))
+                juce::ConsoleApplication::fail("Couldn't read " + stateFile.getFullPathName());
+            processor.setStateInformation(state.getData(), (int)state.getSize());
+        }
+        else if (args.containsOption("--bank"))
+        {
+            const auto bankFile = args.getExistingFileForOption("--bank");
+            const PresetBank bank(bankFile, SynthAudioProcessor::stateTag);
+            if (!bank.isValid())
+                juce::ConsoleApplication::fail(bankFile.getFullPathName() + " isn't a Synth preset bank");
+            if (args.containsOption("--preset"))
+            {
+                const int preset = bank.indexOf(args.getValueForOption("--preset"));
+                if (preset < 0)
+                    juce::ConsoleApplication::fail("No preset called " + args.getValueForOption("--preset") + " in the bank");
+                processor.setStateInformation(bank.getStateData(preset), bank.getStateSize(preset));
+            }
+            else if (processor.loadPrograms(bank) > 0)
+            {
+                // The whole bank as programs, so the file's program changes switch between them.
+                processor.setStateInformation(bank.getStateData(0), bank.getStateSize(0));
+            }
+        }
+        if (args.containsOption("--threads|-t"))
+            processor.setRenderThreads(args.getValueForOption("--threads|-t").getIntValue());
+
+        const int numChannels = 2;
+        processor.setPlayConfigDetails(0, numChannels, sampleRate, blockSize);
+        processor.setNonRealtime(true);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        outputFile.deleteFile();
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(outputFile.createOutputStream().release(),
+                                                                            sampleRate, (unsigned int)numChannels, bitDepth, {}, 0));
+        if (writer == nullptr)
+            juce::ConsoleApplication::fail("Couldn't write to " + outputFile.getFullPathName());
+
+        const auto totalSamples = (juce::int64)std::ceil((sequence.getEndTime() + tailSeconds) * sampleRate);
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::MidiBuffer midiBuffer;
+        int nextEvent = 0;
+        juce::int64 processTicks = 0;
+
+        for (juce::int64 position = 0; position < totalSamples; position += blockSize)
+        {
+            const int numSamples = (int)juce::jmin((juce::int64)blockSize, totalSamples - position);
+            if (numSamples != buffer.getNumSamples())
+                buffer.setSize(numChannels, numSamples, false, false, true);
+
+            midiBuffer.clear();
+            for (; nextEvent < sequence.getNumEvents(); ++nextEvent)
+            {
+                const auto& message = sequence.getEventPointer(nextEvent)->message;
+                const auto samplePosition = (juce::int64)std::round(message.getTimeStamp() * sampleRate);
+                if (samplePosition >= position + numSamples)
+                    break;
+                midiBuffer.addEvent(message, (int)juce::jmax((juce::int64)0, samplePosition - position));
+            }
+
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midiBuffer);
+            processTicks += juce::Time::getHighResolutionTicks() - startTicks;
+
+            writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        }
+
+        processor.releaseResources();
+        writer.reset();
+
+        const auto audioSeconds = (double)totalSamples / sampleRate;
+        const auto processSeconds = juce::Time::highResolutionTicksToSeconds(juce::jmax((juce::int64)1, processTicks));
+        std::cout << "Rendered " << audioSeconds << " s at " << sampleRate << " Hz in blocks of " << blockSize
+                  << " in " << processSeconds << " s (" << audioSeconds / processSeconds << "x realtime)" << std::endl;
+    }
+
+    // Each state file in the folder, legacy or current, is loaded and saved again, so the
+    // bank only ever holds the current format. The file name is the preset's name.
+    void makePresetBank(const juce::ArgumentList& args)
+    {
+        const auto folder = args.getExistingFolderForOption("--make-bank");
+        const auto outputFile = args.getFileForOption("--output|-o");
+
+        std::vector<PresetBank::Preset> presets;
+        for (const auto& entry : juce::RangedDirectoryIterator(folder, false, "*", juce::File::findFiles))
+        {
+            juce::MemoryBlock state;
+            if (!entry.getFile().loadFileAsData(state))
+                juce::ConsoleApplication::fail("Couldn't read " + entry.getFile().getFullPathName());
+
+            SynthAudioProcessor processor;
+            processor.setStateInformation(state.getData(), (int)state.getSize());
+            PresetBank::Preset preset;
+            preset.name = entry.getFile().getFileNameWithoutExtension();
+            processor.getStateInformation(preset.state);
+            presets.push_back(std::move(preset));
+        }
+
+        const auto numPresets = presets.size();
+        if (!PresetBank::write(outputFile, SynthAudioProcessor::stateTag, std::move(presets)))
+            juce::ConsoleApplication::fail("Couldn't write " + outputFile.getFullPathName());
+        std::cout << "Wrote " << numPresets << " presets to " << outputFile.getFullPathName() << std::endl;
+    }
+
+    void listPresetBank(const juce::ArgumentList& args)
+    {
+        const auto bankFile = args.getExistingFileForOption("--list-bank");
+        const PresetBank bank(bankFile, SynthAudioProcessor::stateTag);
+        if (!bank.isValid())
+            juce::ConsoleApplication::fail(bankFile.getFullPathName() + " isn't a Synth preset bank");
+
+        for (const int preset : bank.search(args.getValueForOption("--search")))
+            std::cout << bank.getName(preset) << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // The parameters' value tree expects a message manager, even with no window.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h", "Usage:", true);
+    app.addDefaultCommand({ "--midi",
+                            "--midi|-m in.mid --output|-o out.wav [--state|-s patch.bin | --bank bank.presets [--preset name]] [--rate|-r 48000] [--block|-b 512] [--bits 24] [--tail 2] [--threads|-t 0]",
+                            "Renders a MIDI file to a WAV file and prints the realtime factor.",
+                            "The state file holds the bytes getStateInformation writes; without it or a preset the default patch is used.\n"
+                            "A bank without --preset loads as programs, up to the first 128 presets in name order, starting on the first;\n"
+                            "program changes in the MIDI file then switch between them.\n"
+                            "The tail, in seconds, is rendered after the last event so the release can ring out.",
+                            renderMidiFile });
+    app.addCommand({ "--bench",
+                     "--bench [--seconds 0.25] [--threads|-t n] [--detector-limit 0.2] [--json results.json]",
+                     "Times processBlock, note allocation, the auto-wah and the render threads, and prints JSON.",
+                     "processBlock runs every shape at 1, 16 and 64 voices, blocks of 32 to 4096 samples and 44.1 and 96 kHz,\n"
+                     "with the auto-wah off and on. Each result is the best of a few runs of --seconds of audio.\n"
+                     "Fails if the envelope follower makes the auto-wah more than --detector-limit slower than the LFO.",
+                     runBenchmarks });
+    app.addCommand({ "--make-bank",
+                     "--make-bank folder --output|-o bank.presets",
+                     "Builds a preset bank from every state file in a folder.",
+                     "Each file is named for its preset and holds the bytes getStateInformation writes, in the current or legacy layout.",
+                     makePresetBank });
+    app.addCommand({ "--list-bank",
+                     "--list-bank bank.presets [--search text]",
+                     "Prints the names of a bank's presets, or of those whose names contain the text.",
+                     "Matching ignores ASCII case and reads only the bank's index and names.",
+                     listPresetBank });
+
+    const int result = app.findAndRunCommand(argc, argv);
+
+    // Builds with REALTIME_SAFETY_CHECKS report anything processBlock shouldn't have done.
+    if (RealtimeSafety::getNumViolations() > 0)
+    {
+        RealtimeSafety::printViolations(std::cerr);
+        return result != 0 ? result : 1;
+    }
+    return result;
+}
@@ -9,116 +9,185 @@
 
 //==============================================================================
 SynthAudioProcessorEditor::SynthAudioProcessorEditor(SynthAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p)
+    : AudioProcessorEditor(&p), audioProcessor(p), loadDisplay(p.loadMeter)
 {
     setResizeLimits(480, 240, 1600, 800);
-    setSize(560 * 1.1, 280 * 1.1);
+    setSize(720 * 1.1, 280 * 1.1);
 
     gain.setSliderStyle(juce::Slider::LinearBar);
-    gain.setRange(0.0, 1.0, 0.0001);
     gain.setTextBoxStyle(juce::Slider::TextBoxBelow, false, sliderHeight, sliderHeight * 2);
     gain.setPopupDisplayEnabled(false, false, this);
-    gain.setValue(audioProcessor.gain);
     addAndMakeVisible(&gain);
-    gain.addListener(this);
 
     pulseWidth.setSliderStyle(juce::Slider::LinearBar);
-    pulseWidth.setRange(0.01, 0.99, 0.01);
     pulseWidth.setTextBoxStyle(juce::Slider::TextBoxBelow, false, sliderHeight, sliderHeight * 2);
     pulseWidth.setPopupDisplayEnabled(false, false, this);
     pulseWidth.setTextValueSuffix(" Pulse Width");
-    pulseWidth.setValue(audioProcessor.pulseWidth);
     addAndMakeVisible(&pulseWidth);
-    pulseWidth.addListener(this);
 
     shape.addItem("Sine", 1);
     shape.addItem("Sawtooth", 2);
     shape.addItem("Square", 3);
     shape.addItem("Triangle", 4);
-    shape.setSelectedId(audioProcessor.waveType);
     addAndMakeVisible(&shape);
-    shape.addListener(this);
 
     autoWahButton.setButtonText("Auto-wah");
-    autoWahButton.setToggleState(false, juce::dontSendNotification);
     addAndMakeVisible(&autoWahButton);
     autoWahButton.addListener(this);
 
+    envelopeCurveButton.setButtonText("Exp. envelope");
+    addAndMakeVisible(&envelopeCurveButton);
+
+    bandLimitedButton.setButtonText("Band-limited");
+    addAndMakeVisible(&bandLimitedButton);
+
     // Add auto-wah controls (hidden by default)
     autoWahFrequency.setSliderStyle(juce::Slider::Rotary);
-    autoWahFrequency.setRange(300.0, 1000.0, 1.0);
     autoWahFrequency.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
     autoWahFrequency.setPopupDisplayEnabled(false, false, this);
     autoWahFrequency.setTextValueSuffix(" Hz Frequency");
-    autoWahFrequency.setValue(700.0);
     autoWahFrequency.setTextBoxIsEditable(false);
     autoWahFrequency.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 70, 25);
     addAndMakeVisible(&autoWahFrequency);
     autoWahFrequency.setVisible(false);
-    autoWahFrequency.addListener(this);
 
     autoWahDepth.setSliderStyle(juce::Slider::Rotary);
-    autoWahDepth.setRange(0.5, 1.0, 0.01);
     autoWahDepth.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
     autoWahDepth.setPopupDisplayEnabled(false, false, this);
     autoWahDepth.setTextValueSuffix(" Depth");
-    autoWahDepth.setValue(0.8);
     autoWahDepth.setTextBoxIsEditable(false);
     autoWahDepth.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 70, 25);
     addAndMakeVisible(&autoWahDepth);
     autoWahDepth.setVisible(false);
-    autoWahDepth.addListener(this);
 
     autoWahRate.setSliderStyle(juce::Slider::Rotary);
-    autoWahRate.setRange(1.0, 5.0, 0.1);
     autoWahRate.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
     autoWahRate.setPopupDisplayEnabled(false, false, this);
     autoWahRate.setTextValueSuffix(" Hz Rate");
-    autoWahRate.setValue(2.0);
     autoWahRate.setTextBoxIsEditable(false);
     autoWahRate.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 70, 25);
     addAndMakeVisible(&autoWahRate);
     autoWahRate.setVisible(false);
-    autoWahRate.addListener(this);
+
+    autoWahMode.addItem("LFO", 1);
+    autoWahMode.addItem("Envelope (RMS)", 2);
+    autoWahMode.addItem("Envelope (peak)", 3);
+    addAndMakeVisible(&autoWahMode);
+    autoWahMode.setVisible(false);
+    autoWahMode.addListener(this);
+
+    autoWahSensitivity.setSliderStyle(juce::Slider::Rotary);
+    autoWahSensitivity.setPopupDisplayEnabled(false, false, this);
+    autoWahSensitivity.setTextValueSuffix(" Sensitivity");
+    autoWahSensitivity.setTextBoxIsEditable(false);
+    autoWahSensitivity.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 70, 25);
+    addAndMakeVisible(&autoWahSensitivity);
+    autoWahSensitivity.setVisible(false);
+
+    autoWahAttack.setSliderStyle(juce::Slider::Rotary);
+    autoWahAttack.setPopupDisplayEnabled(false, false, this);
+    autoWahAttack.setTextValueSuffix(" s Attack");
+    autoWahAttack.setTextBoxIsEditable(false);
+    autoWahAttack.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 70, 25);
+    addAndMakeVisible(&autoWahAttack);
+    autoWahAttack.setVisible(false);
+
+    autoWahRelease.setSliderStyle(juce::Slider::Rotary);
+    autoWahRelease.setPopupDisplayEnabled(false, false, this);
+    autoWahRelease.setTextValueSuffix(" s Release");
+    autoWahRelease.setTextBoxIsEditable(false);
+    autoWahRelease.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 70, 25);
+    addAndMakeVisible(&autoWahRelease);
+    autoWahRelease.setVisible(false);
 
     attack.setSliderStyle(juce::Slider::Rotary);
-    attack.setRange(0.001, 5.0, 0.001);
-    attack.setSkewFactorFromMidPoint(0.1);
     attack.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
     attack.setPopupDisplayEnabled(false, false, this);
     attack.setTextValueSuffix(" s attack");
-    attack.setValue(audioProcessor.attack);
     addAndMakeVisible(&attack);
-    attack.addListener(this);
 
     decay.setSliderStyle(juce::Slider::Rotary);
-    decay.setRange(0.001, 5.0, 0.001);
-    decay.setSkewFactorFromMidPoint(0.5);
     decay.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
     decay.setPopupDisplayEnabled(false, false, this);
     decay.setTextValueSuffix(" s decay");
-    decay.setValue(audioProcessor.decay);
     addAndMakeVisible(&decay);
-    decay.addListener(this);
 
     sustain.setSliderStyle(juce::Slider::Rotary);
-    sustain.setRange(0.0, 1.0, 0.01);
     sustain.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
     sustain.setPopupDisplayEnabled(false, false, this);
     sustain.setTextValueSuffix(" sustain");
-    sustain.setValue(audioProcessor.sustain);
     addAndMakeVisible(&sustain);
-    sustain.addListener(this);
 
     release.setSliderStyle(juce::Slider::Rotary);
-    release.setRange(0.001, 5.0, 0.001);
-    release.setSkewFactorFromMidPoint(0.5);
     release.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
     release.setPopupDisplayEnabled(false, false, this);
     release.setTextValueSuffix(" s release");
-    release.setValue(audioProcessor.release);
     addAndMakeVisible(&release);
-    release.addListener(this);
+
+    pan.setSliderStyle(juce::Slider::Rotary);
+    pan.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
+    pan.setPopupDisplayEnabled(false, false, this);
+    pan.setTextValueSuffix(" pan");
+    addAndMakeVisible(&pan);
+
+    stereoSpread.setSliderStyle(juce::Slider::Rotary);
+    stereoSpread.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
+    stereoSpread.setPopupDisplayEnabled(false, false, this);
+    stereoSpread.setTextValueSuffix(" spread");
+    addAndMakeVisible(&stereoSpread);
+
+    unisonVoices.setSliderStyle(juce::Slider::Rotary);
+    unisonVoices.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
+    unisonVoices.setPopupDisplayEnabled(false, false, this);
+    unisonVoices.setTextValueSuffix(" unison");
+    addAndMakeVisible(&unisonVoices);
+
+    unisonDetune.setSliderStyle(juce::Slider::Rotary);
+    unisonDetune.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
+    unisonDetune.setPopupDisplayEnabled(false, false, this);
+    unisonDetune.setTextValueSuffix(" ct detune");
+    addAndMakeVisible(&unisonDetune);
+
+    unisonSpread.setSliderStyle(juce::Slider::Rotary);
+    unisonSpread.setTextBoxStyle(juce::Slider::TextBoxBelow, false, rotaryWidth * 1.1, rotaryWidth * 1.1);
+    unisonSpread.setPopupDisplayEnabled(false, false, this);
+    unisonSpread.setTextValueSuffix(" unison spread");
+    addAndMakeVisible(&unisonSpread);
+
+    loadDisplay.getExtraText = [this]
+    {
+        return juce::String(audioProcessor.getActiveVoices()) + " voices (peak " + juce::String(audioProcessor.getPeakActiveVoices()) + ")";
+    };
+    loadDisplay.onReset = [this] { audioProcessor.resetPeakActiveVoices(); };
+    addAndMakeVisible(&loadDisplay);
+
+    // The attachments set each control's range and value from its parameter.
+    auto& parameters = audioProcessor.parameters;
+    gainAttachment = std::make_unique<SliderAttachment>(parameters, "gain", gain);
+    pulseWidthAttachment = std::make_unique<SliderAttachment>(parameters, "pulseWidth", pulseWidth);
+    shapeAttachment = std::make_unique<ComboBoxAttachment>(parameters, "waveType", shape);
+    autoWahAttachment = std::make_unique<ButtonAttachment>(parameters, "autoWah", autoWahButton);
+    envelopeCurveAttachment = std::make_unique<ButtonAttachment>(parameters, "envelopeCurve", envelopeCurveButton);
+    bandLimitedAttachment = std::make_unique<ButtonAttachment>(parameters, "bandLimited", bandLimitedButton);
+    attackAttachment = std::make_unique<SliderAttachment>(parameters, "attack", attack);
+    decayAttachment = std::make_unique<SliderAttachment>(parameters, "decay", decay);
+    sustainAttachment = std::make_unique<SliderAttachment>(parameters, "sustain", sustain);
+    releaseAttachment = std::make_unique<SliderAttachment>(parameters, "release", release);
+    panAttachment = std::make_unique<SliderAttachment>(parameters, "pan", pan);
+    stereoSpreadAttachment = std::make_unique<SliderAttachment>(parameters, "stereoSpread", stereoSpread);
+    unisonVoicesAttachment = std::make_unique<SliderAttachment>(parameters, "unisonVoices", unisonVoices);
+    unisonDetuneAttachment = std::make_unique<SliderAttachment>(parameters, "unisonDetune", unisonDetune);
+    unisonSpreadAttachment = std::make_unique<SliderAttachment>(parameters, "unisonSpread", unisonSpread);
+    autoWahFrequencyAttachment = std::make_unique<SliderAttachment>(parameters, "autoWahFrequency", autoWahFrequency);
+    autoWahDepthAttachment = std::make_unique<SliderAttachment>(parameters, "autoWahDepth", autoWahDepth);
+    autoWahRateAttachment = std::make_unique<SliderAttachment>(parameters, "autoWahRate", autoWahRate);
+    autoWahModeAttachment = std::make_unique<ComboBoxAttachment>(parameters, "autoWahMode", autoWahMode);
+    autoWahSensitivityAttachment = std::make_unique<SliderAttachment>(parameters, "autoWahSensitivity", autoWahSensitivity);
+    autoWahAttackAttachment = std::make_unique<SliderAttachment>(parameters, "autoWahAttack", autoWahAttack);
+    autoWahReleaseAttachment = std::make_unique<SliderAttachment>(parameters, "autoWahRelease", autoWahRelease);
+    pan.setDoubleClickReturnValue(true, 0.0);
+
+    showAutoWahControls(autoWahButton.getToggleState());
 }
 
 SynthAudioProcessorEditor::~SynthAudioProcessorEditor()
@@ -137,92 +206,100 @@ void SynthAudioProcessorEditor::resized()
 {
     int width = getWidth();
     int height = getHeight();
-    int autoWahWidth = autoWahButton.getToggleState() ? autoWahExpansion : 0;
+    int autoWahWidth = autoWahShown ? autoWahExpansion : 0;
 
     gain.setBounds(margin, margin, width - margin * 2 - autoWahWidth, sliderHeight);
     pulseWidth.setBounds(margin, 2 * margin + sliderHeight, width - margin * 2 - autoWahWidth, sliderHeight);
-    shape.setBounds(margin, 3 * margin + 2 * sliderHeight, (width - margin * 2 - autoWahWidth) * 2 / 3, comboBoxHeight);
+    shape.setBounds(margin, 3 * margin + 2 * sliderHeight, (width - margin * 2 - autoWahWidth) / 2, comboBoxHeight);
+    bandLimitedButton.setBounds(margin + (width - margin * 2 - autoWahWidth) / 2 + margin, 3 * margin + 2 * sliderHeight, (width - margin * 2 - autoWahWidth) / 6 - margin, comboBoxHeight);
     autoWahButton.setBounds(margin + (width - margin * 2 - autoWahWidth) * 2 / 3 + margin, 3 * margin + 2 * sliderHeight, (width - margin * 2 - autoWahWidth) / 6 - margin, comboBoxHeight);
+    envelopeCurveButton.setBounds(margin + (width - margin * 2 - autoWahWidth) * 5 / 6 + margin, 3 * margin + 2 * sliderHeight, (width - margin * 2 - autoWahWidth) / 6 - margin, comboBoxHeight);
 
-    attack.setBounds(margin, 4 * margin + 2 * sliderHeight + comboBoxHeight, (width - margin * 5 - autoWahWidth) / 4, (width - margin * 5 - autoWahWidth) / 4);
-    decay.setBounds(margin * 2 + ((width - margin * 5 - autoWahWidth) / 4), 4 * margin + 2 * sliderHeight + comboBoxHeight, (width - margin * 5 - autoWahWidth) / 4, (width - margin * 5 - autoWahWidth) / 4);
-    sustain.setBounds(margin * 3 + (2 * (width - margin * 5 - autoWahWidth) / 4), 4 * margin + 2 * sliderHeight + comboBoxHeight, (width - margin * 5 - autoWahWidth) / 4, (width - margin * 5 - autoWahWidth) / 4);
-    release.setBounds(margin * 4 + (3 * (width - margin * 5 - autoWahWidth) / 4), 4 * margin + 2 * sliderHeight + comboBoxHeight, (width - margin * 5 - autoWahWidth) / 4, (width - margin * 5 - autoWahWidth) / 4);
+    int knobSize = (width - margin * 10 - autoWahWidth) / 9;
+    int knobY = 4 * margin + 2 * sliderHeight + comboBoxHeight;
+    attack.setBounds(margin, knobY, knobSize, knobSize);
+    decay.setBounds(margin * 2 + knobSize, knobY, knobSize, knobSize);
+    sustain.setBounds(margin * 3 + 2 * knobSize, knobY, knobSize, knobSize);
+    release.setBounds(margin * 4 + 3 * knobSize, knobY, knobSize, knobSize);
+    pan.setBounds(margin * 5 + 4 * knobSize, knobY, knobSize, knobSize);
+    stereoSpread.setBounds(margin * 6 + 5 * knobSize, knobY, knobSize, knobSize);
+    unisonVoices.setBounds(margin * 7 + 6 * knobSize, knobY, knobSize, knobSize);
+    unisonDetune.setBounds(margin * 8 + 7 * knobSize, knobY, knobSize, knobSize);
+    unisonSpread.setBounds(margin * 9 + 8 * knobSize, knobY, knobSize, knobSize);
+    loadDisplay.setBounds(margin, height - margin - 20, width - margin * 2 - autoWahWidth, 20);
 
-    if (autoWahButton.getToggleState())
+    if (autoWahShown)
     {
-        int autoWahControlHeight = (height - 4 * margin) / 3;
-        autoWahFrequency.setBounds(width - autoWahWidth + margin, margin, autoWahWidth - margin * 2, autoWahControlHeight);
-        autoWahDepth.setBounds(width - autoWahWidth + margin, 2 * margin + autoWahControlHeight, autoWahWidth - margin * 2, autoWahControlHeight);
-        autoWahRate.setBounds(width - autoWahWidth + margin, 3 * margin + 2 * autoWahControlHeight, autoWahWidth - margin * 2, autoWahControlHeight);
+        // The mode on top, then a row for each knob the mode uses; attack and release share one.
+        const bool follower = autoWahMode.getSelectedId() != LfoWah;
+        int numRows = follower ? 4 : 3;
+        int panelX = width - autoWahWidth + margin;
+        int panelWidth = autoWahWidth - margin * 2;
+        autoWahMode.setBounds(panelX, margin, panelWidth, comboBoxHeight);
+
+        int autoWahControlHeight = (height - comboBoxHeight - (numRows + 2) * margin) / numRows;
+        int rowY = 2 * margin + comboBoxHeight;
+        autoWahFrequency.setBounds(panelX, rowY, panelWidth, autoWahControlHeight);
+        rowY += margin + autoWahControlHeight;
+        autoWahDepth.setBounds(panelX, rowY, panelWidth, autoWahControlHeight);
+        rowY += margin + autoWahControlHeight;
+        if (follower)
+        {
+            autoWahSensitivity.setBounds(panelX, rowY, panelWidth, autoWahControlHeight);
+            rowY += margin + autoWahControlHeight;
+            autoWahAttack.setBounds(panelX, rowY, (panelWidth - margin) / 2, autoWahControlHeight);
+            autoWahRelease.setBounds(panelX + (panelWidth + margin) / 2, rowY, (panelWidth - margin) / 2, autoWahControlHeight);
+        }
+        else
+        {
+            autoWahRate.setBounds(panelX, rowY, panelWidth, autoWahControlHeight);
+        }
     }
 }
 
-void SynthAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
+void SynthAudioProcessorEditor::buttonClicked(juce::Button* button)
 {
-    if (slider == &gain)
-    {
-        audioProcessor.gain = gain.getValue();
-    }
-    else if (slider == &pulseWidth)
-    {
-        audioProcessor.pulseWidth = pulseWidth.getValue();
-    }
-    else if (slider == &attack)
-    {
-        audioProcessor.attack = attack.getValue();
-    }
-    else if (slider == &decay)
-    {
-        audioProcessor.decay = decay.getValue();
-    }
-    else if (slider == &sustain)
-    {
-        audioProcessor.sustain = sustain.getValue();
-    }
-    else if (slider == &release)
-    {
-        audioProcessor.release = release.getValue();
-    }
-    else if (slider == &autoWahFrequency)
-    {
-        audioProcessor.autoWahFrequency = autoWahFrequency.getValue();
-    }
-    else if (slider == &autoWahDepth)
-    {
-        audioProcessor.autoWahDepth = autoWahDepth.getValue();
-    }
-    else if (slider == &autoWahRate)
+    if (button == &autoWahButton)
     {
-        audioProcessor.autoWahRate = autoWahRate.getValue();
+        showAutoWahControls(autoWahButton.getToggleState());
     }
 }
 
 void SynthAudioProcessorEditor::comboBoxChanged(juce::ComboBox* comboBox)
 {
-    if (comboBox == &shape)
+    if (comboBox == &autoWahMode)
     {
-        audioProcessor.waveType = (WaveType)shape.getSelectedId();
+        showAutoWahControls(autoWahButton.getToggleState());
     }
 }
 
-void SynthAudioProcessorEditor::buttonClicked(juce::Button* button)
+void SynthAudioProcessorEditor::showAutoWahControls(bool shouldShow)
 {
-    if (button == &autoWahButton)
+    // The rate only drives the LFO; the follower has its own knobs.
+    const bool follower = autoWahMode.getSelectedId() != LfoWah;
+    autoWahMode.setVisible(shouldShow);
+    autoWahFrequency.setVisible(shouldShow);
+    autoWahDepth.setVisible(shouldShow);
+    autoWahRate.setVisible(shouldShow && !follower);
+    autoWahSensitivity.setVisible(shouldShow && follower);
+    autoWahAttack.setVisible(shouldShow && follower);
+    autoWahRelease.setVisible(shouldShow && follower);
+
+    // The attachment can report the same state again, so only resize on a change;
+    // a mode change still needs the panel laid out again.
+    if (shouldShow == autoWahShown)
     {
-        bool isAutoWahEnabled = autoWahButton.getToggleState();
-        audioProcessor.autoWah = isAutoWahEnabled;
-        autoWahFrequency.setVisible(isAutoWahEnabled);
-        autoWahDepth.setVisible(isAutoWahEnabled);
-        autoWahRate.setVisible(isAutoWahEnabled);
+        resized();
+        return;
+    }
 
-        if (isAutoWahEnabled)
-        {
-            setSize(getWidth() + autoWahExpansion, getHeight());
-        }
-        else
-        {
-            setSize(getWidth() - autoWahExpansion, getHeight());
-        }
+    autoWahShown = shouldShow;
+    if (shouldShow)
+    {
+        setSize(getWidth() + autoWahExpansion, getHeight());
     }
-}
\ No newline at end of file
+    else
+    {
+        setSize(getWidth() - autoWahExpansion, getHeight());
+    }
+}
@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "../Shared/LoadMeterDisplay.h"
 
 class DecibelSlider : public juce::Slider
 {
@@ -40,9 +41,8 @@ public:
 /**
 */
 class SynthAudioProcessorEditor : public juce::AudioProcessorEditor,
-    public juce::Slider::Listener,
-    public juce::ComboBox::Listener,
-    public juce::Button::Listener
+    public juce::Button::Listener,
+    public juce::ComboBox::Listener
 {
 public:
     SynthAudioProcessorEditor(SynthAudioProcessor&);
@@ -53,9 +53,13 @@ public:
     void resized() override;
 
 private:
-    void sliderValueChanged(juce::Slider* slider) override;
-    void comboBoxChanged(juce::ComboBox* comboBox) override;
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+
     void buttonClicked(juce::Button* button) override;
+    void comboBoxChanged(juce::ComboBox* comboBox) override;
+    void showAutoWahControls(bool shouldShow);
 
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -65,16 +69,41 @@ private:
     juce::Slider pulseWidth;
     juce::ComboBox shape;
     juce::ToggleButton autoWahButton;
+    juce::ToggleButton envelopeCurveButton;
+    juce::ToggleButton bandLimitedButton;
 
     juce::Slider attack;
     juce::Slider decay;
     juce::Slider sustain;
     juce::Slider release;
+    juce::Slider pan;
+    juce::Slider stereoSpread;
+    juce::Slider unisonVoices;
+    juce::Slider unisonDetune;
+    juce::Slider unisonSpread;
 
     // Auto-wah controls
     juce::Slider autoWahFrequency;
     juce::Slider autoWahDepth;
     juce::Slider autoWahRate;
+    juce::ComboBox autoWahMode;
+    juce::Slider autoWahSensitivity;
+    juce::Slider autoWahAttack;
+    juce::Slider autoWahRelease;
+    bool autoWahShown = false;
+
+    LoadMeterDisplay loadDisplay;
+
+    // Declared after the controls, so they are destroyed first.
+    std::unique_ptr<SliderAttachment> gainAttachment, pulseWidthAttachment;
+    std::unique_ptr<ComboBoxAttachment> shapeAttachment;
+    std::unique_ptr<ButtonAttachment> autoWahAttachment, envelopeCurveAttachment, bandLimitedAttachment;
+    std::unique_ptr<SliderAttachment> attackAttachment, decayAttachment, sustainAttachment, releaseAttachment;
+    std::unique_ptr<SliderAttachment> panAttachment, stereoSpreadAttachment;
+    std::unique_ptr<SliderAttachment> unisonVoicesAttachment, unisonDetuneAttachment, unisonSpreadAttachment;
+    std::unique_ptr<SliderAttachment> autoWahFrequencyAttachment, autoWahDepthAttachment, autoWahRateAttachment;
+    std::unique_ptr<ComboBoxAttachment> autoWahModeAttachment;
+    std::unique_ptr<SliderAttachment> autoWahSensitivityAttachment, autoWahAttackAttachment, autoWahReleaseAttachment;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthAudioProcessorEditor)
 };
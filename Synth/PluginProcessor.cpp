@@ -1,5 +1,81 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "../Shared/RealtimeSafety.h"
+
+namespace
+{
+    const juce::uint16 stateVersion = 1;
+
+    using ProgramValues = SynthParameterSet<float>;
+
+    // The keys are in saved states, so never renumber or reuse one.
+    const struct
+    {
+        juce::uint16 key;
+        const char* parameterID;
+        float ProgramValues::* value;
+    } stateParameters[] = {
+        { 1, "gain", &ProgramValues::gain }, { 2, "pulseWidth", &ProgramValues::pulseWidth },
+        { 3, "waveType", &ProgramValues::waveType }, { 4, "bandLimited", &ProgramValues::bandLimited },
+        { 5, "attack", &ProgramValues::attack }, { 6, "decay", &ProgramValues::decay },
+        { 7, "sustain", &ProgramValues::sustain }, { 8, "release", &ProgramValues::release },
+        { 9, "envelopeCurve", &ProgramValues::envelopeCurve },
+        { 10, "pan", &ProgramValues::pan }, { 11, "stereoSpread", &ProgramValues::stereoSpread },
+        { 12, "unisonVoices", &ProgramValues::unisonVoices }, { 13, "unisonDetune", &ProgramValues::unisonDetune },
+        { 14, "unisonSpread", &ProgramValues::unisonSpread },
+        { 15, "autoWah", &ProgramValues::autoWah }, { 16, "autoWahFrequency", &ProgramValues::autoWahFrequency },
+        { 17, "autoWahDepth", &ProgramValues::autoWahDepth }, { 18, "autoWahRate", &ProgramValues::autoWahRate },
+        { 19, "autoWahMode", &ProgramValues::autoWahMode }, { 20, "autoWahSensitivity", &ProgramValues::autoWahSensitivity },
+        { 21, "autoWahAttack", &ProgramValues::autoWahAttack }, { 22, "autoWahRelease", &ProgramValues::autoWahRelease },
+    };
+
+    // Settings that aren't parameters.
+    enum : juce::uint16
+    {
+        maxVoicesKey = 100,
+        voiceStealingKey = 101,
+        renderThreadsKey = 102
+    };
+
+    float valueOf(float value)                          { return value; }
+    float valueOf(const std::atomic<float>* value)      { return value->load(); }
+
+    // The same rules for the live parameters and for a program's copy of them.
+    template <typename Value>
+    SynthPatch makePatch(const SynthParameterSet<Value>& values)
+    {
+        SynthPatch newPatch;
+        newPatch.gain = valueOf(values.gain);
+        newPatch.pulseWidth = valueOf(values.pulseWidth);
+        newPatch.waveType = (WaveType)(Sine + juce::jlimit(0, 3, juce::roundToInt(valueOf(values.waveType))));
+        newPatch.bandLimited = valueOf(values.bandLimited) >= 0.5f;
+        newPatch.envelope.attack = valueOf(values.attack);
+        newPatch.envelope.decay = valueOf(values.decay);
+        newPatch.envelope.sustain = valueOf(values.sustain);
+        newPatch.envelope.release = valueOf(values.release);
+        newPatch.envelope.curve = valueOf(values.envelopeCurve) >= 0.5f ? ExponentialCurve : LinearCurve;
+        newPatch.pan = valueOf(values.pan);
+        newPatch.stereoSpread = valueOf(values.stereoSpread);
+        newPatch.unisonVoices = juce::jlimit(1, VoiceBank::maxUnison, juce::roundToInt(valueOf(values.unisonVoices)));
+        newPatch.unisonDetune = valueOf(values.unisonDetune);
+        newPatch.unisonSpread = valueOf(values.unisonSpread);
+        newPatch.autoWah = valueOf(values.autoWah) >= 0.5f;
+        newPatch.autoWahFrequency = valueOf(values.autoWahFrequency);
+        newPatch.autoWahDepth = valueOf(values.autoWahDepth);
+        newPatch.autoWahRate = valueOf(values.autoWahRate);
+        newPatch.autoWahMode = (AutoWahMode)(LfoWah + juce::jlimit(0, 2, juce::roundToInt(valueOf(values.autoWahMode))));
+        newPatch.autoWahSensitivity = valueOf(values.autoWahSensitivity);
+        newPatch.autoWahAttack = valueOf(values.autoWahAttack);
+        newPatch.autoWahRelease = valueOf(values.autoWahRelease);
+        return newPatch;
+    }
+
+    // With everything centred, both sides are the same, so one bus is rendered and copied.
+    bool needsStereo(const SynthPatch& patch)
+    {
+        return patch.pan != 0.0f || patch.stereoSpread != 0.0f || (patch.unisonVoices > 1 && patch.unisonSpread != 0.0f);
+    }
+}
 
 //==============================================================================
 SynthAudioProcessor::SynthAudioProcessor()
@@ -14,13 +90,97 @@ SynthAudioProcessor::SynthAudioProcessor()
 
     )
 #endif
+    , parameters(*this, nullptr, "Synth", createParameterLayout())
 {
-    for (int i = 0; i < maxVoices; ++i)
-        voices.add(new Voice());
+    parameterValues.gain = parameters.getRawParameterValue("gain");
+    parameterValues.pulseWidth = parameters.getRawParameterValue("pulseWidth");
+    parameterValues.waveType = parameters.getRawParameterValue("waveType");
+    parameterValues.bandLimited = parameters.getRawParameterValue("bandLimited");
+    parameterValues.attack = parameters.getRawParameterValue("attack");
+    parameterValues.decay = parameters.getRawParameterValue("decay");
+    parameterValues.sustain = parameters.getRawParameterValue("sustain");
+    parameterValues.release = parameters.getRawParameterValue("release");
+    parameterValues.envelopeCurve = parameters.getRawParameterValue("envelopeCurve");
+    parameterValues.pan = parameters.getRawParameterValue("pan");
+    parameterValues.stereoSpread = parameters.getRawParameterValue("stereoSpread");
+    parameterValues.unisonVoices = parameters.getRawParameterValue("unisonVoices");
+    parameterValues.unisonDetune = parameters.getRawParameterValue("unisonDetune");
+    parameterValues.unisonSpread = parameters.getRawParameterValue("unisonSpread");
+    parameterValues.autoWah = parameters.getRawParameterValue("autoWah");
+    parameterValues.autoWahFrequency = parameters.getRawParameterValue("autoWahFrequency");
+    parameterValues.autoWahDepth = parameters.getRawParameterValue("autoWahDepth");
+    parameterValues.autoWahRate = parameters.getRawParameterValue("autoWahRate");
+    parameterValues.autoWahMode = parameters.getRawParameterValue("autoWahMode");
+    parameterValues.autoWahSensitivity = parameters.getRawParameterValue("autoWahSensitivity");
+    parameterValues.autoWahAttack = parameters.getRawParameterValue("autoWahAttack");
+    parameterValues.autoWahRelease = parameters.getRawParameterValue("autoWahRelease");
+    patch = readPatch();
+
+    for (int i = 0; i < VoiceAllocator::maxPolyphony; ++i)
+        voices.add(new Voice(voiceBank, patch, i));
+    voiceBank.setThreadPool(&renderThreads);
+    fadeBank.setThreadPool(&renderThreads);
 }
 
 SynthAudioProcessor::~SynthAudioProcessor()
 {
+    stopTimer();
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout SynthAudioProcessor::createParameterLayout()
+{
+    auto seconds = [](float centre)
+    {
+        juce::NormalisableRange<float> range(0.001f, 5.0f, 0.001f);
+        range.setSkewForCentre(centre);
+        return range;
+    };
+
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "gain", 1 }, "Gain", juce::NormalisableRange<float>(0.0f, 1.0f, 0.0001f), 0.2512f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "pulseWidth", 1 }, "Pulse Width", juce::NormalisableRange<float>(0.01f, 0.99f, 0.01f), 0.5f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "waveType", 1 }, "Shape", juce::StringArray { "Sine", "Sawtooth", "Square", "Triangle" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "bandLimited", 1 }, "Band-limited", true));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "attack", 1 }, "Attack", seconds(0.1f), 0.02f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "decay", 1 }, "Decay", seconds(0.5f), 0.04f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "sustain", 1 }, "Sustain", juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.7f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "release", 1 }, "Release", seconds(0.5f), 0.03f));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "envelopeCurve", 1 }, "Exp. envelope", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "pan", 1 }, "Pan", juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f), 0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "stereoSpread", 1 }, "Spread", juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.0f));
+    layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID { "unisonVoices", 1 }, "Unison", 1, VoiceBank::maxUnison, 1));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "unisonDetune", 1 }, "Detune", juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 20.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "unisonSpread", 1 }, "Unison Spread", juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.5f));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "autoWah", 1 }, "Auto-wah", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "autoWahFrequency", 1 }, "Auto-wah Frequency", juce::NormalisableRange<float>(300.0f, 1000.0f, 1.0f), 700.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "autoWahDepth", 1 }, "Auto-wah Depth", juce::NormalisableRange<float>(0.5f, 1.0f, 0.01f), 0.8f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "autoWahRate", 1 }, "Auto-wah Rate", juce::NormalisableRange<float>(1.0f, 5.0f, 0.1f), 2.0f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "autoWahMode", 1 }, "Auto-wah Mode", juce::StringArray { "LFO", "Envelope (RMS)", "Envelope (peak)" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "autoWahSensitivity", 1 }, "Auto-wah Sensitivity", juce::NormalisableRange<float>(1.0f, 20.0f, 0.1f, 0.5f), 4.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "autoWahAttack", 1 }, "Auto-wah Attack", juce::NormalisableRange<float>(0.001f, 0.2f, 0.001f, 0.5f), 0.01f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "autoWahRelease", 1 }, "Auto-wah Release", juce::NormalisableRange<float>(0.01f, 1.0f, 0.001f, 0.5f), 0.15f));
+    return layout;
+}
+
+SynthPatch SynthAudioProcessor::readPatch() const
+{
+    return makePatch(parameterValues);
+}
+
+SynthPatch SynthAudioProcessor::currentPatch() const
+{
+    if (const auto* program = activeProgram.load(std::memory_order_acquire))
+        return program->patch;
+    return readPatch();
+}
+
+void SynthAudioProcessor::setParameterValue(const juce::String& parameterID, float value)
+{
+    // Values come from saved states, where NaN or infinity can only mean damage.
+    if (!std::isfinite(value))
+        return;
+    if (auto* parameter = parameters.getParameter(parameterID))
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
 }
 
 //==============================================================================
@@ -58,54 +218,163 @@ bool SynthAudioProcessor::isMidiEffect() const
 
 double SynthAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The longest a note can sound after its note-off, plus the filter ringing out after it.
+    const auto current = currentPatch();
+    auto tail = juce::jmax(current.envelope.release, AdsrEnvelope::getFastReleaseSeconds());
+    if (current.autoWah)
+        tail += AutoWah::getTailSeconds(current.autoWahFrequency);
+    return tail;
 }
 
 int SynthAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-    // so this should be at least 1, even if you're not really implementing programs.
+    // NB: some hosts don't cope very well if you tell them there are 0 programs.
+    return juce::jmax(1, numPrograms);
 }
 
 int SynthAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load(std::memory_order_relaxed);
 }
 
 void SynthAudioProcessor::setCurrentProgram(int index)
 {
+    // Picked up at the start of the next block, which fades over to it.
+    requestedProgram.store(index, std::memory_order_relaxed);
 }
 
 const juce::String SynthAudioProcessor::getProgramName(int index)
 {
-    return {};
+    if (index < 0 || index >= numPrograms)
+        return {};
+    return juce::String::fromUTF8(programs[(size_t)index].name);
 }
 
 void SynthAudioProcessor::changeProgramName(int index, const juce::String& newName)
 {
+    if (index >= 0 && index < numPrograms)
+        newName.copyToUTF8(programs[(size_t)index].name, sizeof(programs[(size_t)index].name));
+}
+
+int SynthAudioProcessor::loadPrograms(const PresetBank& bank)
+{
+    // Decoded into a table of its own first, so processing is only held off for the copy.
+    auto table = std::make_unique<std::array<SynthProgram, maxPrograms>>();
+    ProgramValues defaults {};
+    for (const auto& parameter : stateParameters)
+    {
+        auto* ranged = parameters.getParameter(parameter.parameterID);
+        defaults.*parameter.value = ranged->convertFrom0to1(ranged->getDefaultValue());
+    }
+
+    const int count = bank.isValid() ? juce::jmin(maxPrograms, bank.size()) : 0;
+    for (int i = 0; i < count; ++i)
+    {
+        auto& program = (*table)[(size_t)i];
+        bank.getName(i).copyToUTF8(program.name, sizeof(program.name));
+        program.values = defaults;
+
+        // Anything missing, and a legacy state as a whole, keeps the defaults.
+        const PluginState::Reader reader(bank.getStateData(i), bank.getStateSize(i), stateTag);
+        for (int field = 0; field < reader.getNumFields(); ++field)
+            for (const auto& parameter : stateParameters)
+                if (parameter.key == reader.getKey(field))
+                {
+                    auto* ranged = parameters.getParameter(parameter.parameterID);
+                    program.values.*parameter.value = ranged->convertFrom0to1(ranged->convertTo0to1(reader.getValue(field)));
+                }
+        program.patch = makePatch(program.values);
+    }
+
+    suspendProcessing(true);
+    programs = *table;
+    numPrograms = count;
+    activeProgram.store(nullptr);
+    programToCopy.store(-1);
+    requestedProgram.store(-1);
+    currentProgram.store(0);
+    suspendProcessing(false);
+
+    // Only for showing a switched-to program in the parameters; see activeProgram.
+    if (numPrograms > 0)
+        startTimerHz(30);
+    else
+        stopTimer();
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+    return count;
+}
+
+void SynthAudioProcessor::timerCallback()
+{
+    const int index = programToCopy.exchange(-1, std::memory_order_acquire);
+    if (index < 0)
+        return;
+
+    const auto* program = &programs[(size_t)index];
+    for (const auto& parameter : stateParameters)
+        setParameterValue(parameter.parameterID, program->values.*parameter.value);
+
+    // The parameters now say the same as the program, unless the audio thread has
+    // switched again meanwhile; then the next tick copies that one.
+    activeProgram.compare_exchange_strong(program, nullptr, std::memory_order_acq_rel);
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
 }
 
 //==============================================================================
 void SynthAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     currentSampleRate = sampleRate;
+    patch = currentPatch();
+    gainSmoother.reset(sampleRate, smoothingSeconds);
+    gainSmoother.setCurrentAndTargetValue(patch.gain);
+    pulseWidthSmoother.reset(sampleRate, smoothingSeconds);
+    pulseWidthSmoother.setCurrentAndTargetValue(patch.pulseWidth);
+    programFade.reset(sampleRate, programFadeSeconds);
+    programFade.setCurrentAndTargetValue(0.0f);
+
+    voiceBank.prepare(VoiceAllocator::maxPolyphony, sampleRate, samplesPerBlock);
+    fadeBank.prepare(VoiceAllocator::maxPolyphony, sampleRate, samplesPerBlock);
+    fadeLeft.assign((size_t)samplesPerBlock, 0.0f);
+    fadeRight.assign((size_t)samplesPerBlock, 0.0f);
+    voiceBank.setUnison(patch.unisonVoices, patch.unisonDetune, patch.unisonSpread);
+    voiceAllocator.reset();
+    renderThreads.setBlockDuration(samplesPerBlock / sampleRate);
+    if (renderThreads.getNumThreads() != numRenderThreads)
+        renderThreads.start(numRenderThreads);
     for (auto* voice : voices)
     {
         voice->setSampleRate(sampleRate);
-        voice->setGlobalParameters(gain, pulseWidth, waveType, attack, decay, sustain, release);
-		voice->noteOn();
-		voice->noteOff();
+        voice->updatePan();
     }
 
-    autoWahFilter.reset();
-    lfoPhase = 0.0;
-    lfoPhaseIncrement = autoWahRate / sampleRate;
-    updateAutoWahFilter(0.0);
+    autoWah.setMode(patch.autoWahMode);
+    autoWah.setFollower(patch.autoWahSensitivity, patch.autoWahAttack, patch.autoWahRelease);
+    autoWah.prepare(sampleRate, getTotalNumOutputChannels());
+    autoWah.setParameters(patch.autoWahFrequency, patch.autoWahDepth, patch.autoWahRate);
+
+    loadMeter.prepare(sampleRate);
 }
 
 
 void SynthAudioProcessor::releaseResources()
 {
+    renderThreads.stop();
+}
+
+void SynthAudioProcessor::setRenderThreads(int numThreads)
+{
+    numThreads = juce::jlimit(0, RenderThreadPool::maxThreads, numThreads);
+    if (numThreads == numRenderThreads)
+        return;
+
+    numRenderThreads = numThreads;
+    if (currentSampleRate <= 0.0)
+        return;
+
+    // Workers are only started and stopped while no block is being rendered.
+    suspendProcessing(true);
+    renderThreads.start(numRenderThreads);
+    suspendProcessing(false);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -131,112 +400,229 @@ bool SynthAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) con
 
 void SynthAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    const RealtimeSafety::ScopedCheck realtimeCheck;
+    const LoadMeter::ScopedTimer loadTimer(loadMeter, buffer.getNumSamples());
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     buffer.clear();
 
-    for (const auto metadata : midiMessages)
+    const int numSamples = buffer.getNumSamples();
+
+    // A host's program switch lands at the start of the block, before the snapshot.
+    const auto previousPatch = patch;
+    const int requested = requestedProgram.exchange(-1, std::memory_order_relaxed);
+    if (requested >= 0)
+        switchProgram(requested);
+
+    // One snapshot per block, so every voice and every sub-block sees the same values
+    // up to any program change.
+    applyPatch(currentPatch());
+
+    // Nothing sounding and nothing to start, so the cleared buffer is already the output.
+    const bool engineSilent = midiMessages.isEmpty() && !voiceBank.hasActiveVoices() && !programFade.isSmoothing();
+    if (engineSilent)
+    {
+        gainSmoother.skip(numSamples);
+        pulseWidthSmoother.skip(numSamples);
+    }
+    else
     {
-        auto message = metadata.getMessage();
-        if (message.isNoteOn())
+        // Render up to each event, then apply it, so notes and program changes land on their
+        // exact sample. Rendering goes stereo from the first point either patch needs it,
+        // with the mono render so far copied across.
+        bool stereo = false;
+        int position = 0;
+        auto renderTo = [&](int end)
         {
-            for (auto* voice : voices)
+            if (!stereo && totalNumOutputChannels > 1
+                && (needsStereo(patch) || (programFade.isSmoothing() && needsStereo(fadePatch))))
             {
-                if (!voice->isPlaying())
-                {
-                    voice->setFrequency(juce::MidiMessage::getMidiNoteInHertz(message.getNoteNumber()));
-                    voice->setVelocity(message.getVelocity());
-                    voice->noteOn();
-                    break;
-                }
-                else if (voice->isPlaying() && voice->getFrequency() == juce::MidiMessage::getMidiNoteInHertz(message.getNoteNumber()))
-                {
-                    voice->noteOff();
-                    voice->setFrequency(juce::MidiMessage::getMidiNoteInHertz(message.getNoteNumber()));
-                    voice->setVelocity(message.getVelocity());
-                    voice->noteOn();
-                    break;
-                }
+                buffer.copyFrom(1, 0, buffer, 0, 0, position);
+                stereo = true;
             }
-        }
-        else if (message.isNoteOff())
+            renderVoices(buffer, position, end - position, stereo);
+            position = end;
+        };
+
+        for (const auto metadata : midiMessages)
         {
-            for (auto* voice : voices)
-            {
-                if (voice->isPlaying() && voice->getFrequency() == juce::MidiMessage::getMidiNoteInHertz(message.getNoteNumber()))
-                {
-                    voice->noteOff();
-                    break;
-                }
-            }
+            renderTo(juce::jlimit(position, numSamples, metadata.samplePosition));
+            handleMidiEvent(metadata.getMessage());
         }
-    }
+        renderTo(numSamples);
 
-    for (auto* voice : voices)
-    {
-        voice->setGlobalParameters(gain, pulseWidth, waveType, attack, decay, sustain, release);
-        if (voice->isPlaying())
-            voice->processBlock(buffer);
+        for (int channel = stereo ? 2 : 1; channel < totalNumOutputChannels; ++channel)
+            buffer.copyFrom(channel, 0, buffer, 0, 0, numSamples);
+
+        // Master gain is applied to the mix rather than to each voice, so it can ramp per sample.
+        gainSmoother.applyGain(buffer, numSamples);
     }
 
-    if (autoWah)
+    // The bank's levels are only looked over here, once a block, so a steal stays constant-time.
+    if (voiceAllocator.getStealingPolicy() == StealQuietest)
+        voiceAllocator.setQuietestVoice(voiceBank.getQuietestVoice());
+
+    const int numActiveVoices = voiceAllocator.getNumActiveVoices();
+    activeVoices.store(numActiveVoices, std::memory_order_relaxed);
+    if (numActiveVoices > peakActiveVoices.load(std::memory_order_relaxed))
+        peakActiveVoices.store(numActiveVoices, std::memory_order_relaxed);
+
+    if (patch.autoWah)
     {
+        // Switched on again: don't ring out whatever the filter held when it was switched off.
+        if (!previousPatch.autoWah)
+            autoWah.reset();
+
+        autoWah.setParameters(patch.autoWahFrequency, patch.autoWahDepth, patch.autoWahRate);
+        autoWah.setMode(patch.autoWahMode);
+        if (patch.autoWahSensitivity != previousPatch.autoWahSensitivity || patch.autoWahAttack != previousPatch.autoWahAttack
+            || patch.autoWahRelease != previousPatch.autoWahRelease)
+            autoWah.setFollower(patch.autoWahSensitivity, patch.autoWahAttack, patch.autoWahRelease);
         if (auto* playHead = getPlayHead())
         {
-            juce::AudioPlayHead::CurrentPositionInfo positionInfo;
-            if (playHead->getCurrentPosition(positionInfo))
-            {
-                updateAutoWahFilter(positionInfo.timeInSeconds);
-            }
-            else
-            {
-                updateAutoWahFilterWithPhase();
-            }
-        }
-        else
-        {
-            updateAutoWahFilterWithPhase();
+            const auto position = playHead->getPosition();
+            if (position.hasValue() && position->getIsPlaying())
+                if (const auto seconds = position->getTimeInSeconds())
+                    autoWah.syncToTime(*seconds);
         }
 
-        auto* firstChannelData = buffer.getWritePointer(0);
-        
-        for (int channel = 1; channel < buffer.getNumChannels(); ++channel)
-        {
-            auto* channelData = buffer.getWritePointer(channel);
-            autoWahFilter.processSamples(channelData, buffer.getNumSamples());
-            //channelData = firstChannelData;
-        }
+        // Once the voices have stopped and the filter has rung out, only its LFO and
+        // follower need to keep time.
+        if (engineSilent && autoWah.isIdle())
+            autoWah.skip(numSamples);
+        else
+            autoWah.process(buffer, numSamples);
     }
 }
 
 
 
-void SynthAudioProcessor::updateAutoWahFilter(double currentTimeInSeconds)
+void SynthAudioProcessor::renderVoices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool stereo)
 {
-    if (autoWah)
+    if (numSamples <= 0)
+        return;
+
+    // Only the square uses the pulse width, so only it is split up while the width glides.
+    int start = startSample;
+    int remaining = numSamples;
+    while (remaining > 0)
     {
-        double lfo = 0.5 * (1.0 + std::sin(2.0 * juce::MathConstants<double>::pi * autoWahRate * currentTimeInSeconds));
-        double cutoff = autoWahFrequency + autoWahDepth * lfo * autoWahFrequency;
-        autoWahFilter.setCoefficients(juce::IIRCoefficients::makeBandPass(currentSampleRate, cutoff, 1.0));
+        const bool gliding = patch.waveType == Square && pulseWidthSmoother.isSmoothing();
+        const int length = gliding ? juce::jmin(remaining, smoothingSubBlock) : remaining;
+        const auto pulseWidth = pulseWidthSmoother.skip(length);
+
+        voiceBank.render(buffer.getWritePointer(0, start), stereo ? buffer.getWritePointer(1, start) : nullptr,
+                         length, patch.waveType, pulseWidth, patch.bandLimited);
+        start += length;
+        remaining -= length;
     }
+
+    voiceBank.takeFinishedVoices([this](int voice) { voiceAllocator.voiceFinished(voice); });
+    if (programFade.isSmoothing())
+        mixProgramFade(buffer, startSample, numSamples, stereo);
+}
+
+void SynthAudioProcessor::applyPatch(const SynthPatch& newPatch)
+{
+    const auto previous = patch;
+    patch = newPatch;
+    voiceBank.setEnvelopeParameters(patch.envelope);
+    gainSmoother.setTargetValue(patch.gain);
+    pulseWidthSmoother.setTargetValue(patch.pulseWidth);
+    if (patch.pan != previous.pan || patch.stereoSpread != previous.stereoSpread)
+        for (auto* voice : voices)
+            voice->updatePan();
+    if (patch.unisonVoices != previous.unisonVoices || patch.unisonDetune != previous.unisonDetune
+        || patch.unisonSpread != previous.unisonSpread)
+        voiceBank.setUnison(patch.unisonVoices, patch.unisonDetune, patch.unisonSpread);
 }
 
-void SynthAudioProcessor::updateAutoWahFilterWithPhase()
+void SynthAudioProcessor::switchProgram(int program)
 {
-    if (autoWah)
+    if (program < 0 || program >= numPrograms)
+        return;
+
+    // The voices go on under the new patch from here, and a copy of them under the old one
+    // fades out over the top. A switch inside a fade starts a new one from the voices as
+    // they are, dropping what's left of the older program.
+    if (voiceBank.hasActiveVoices())
     {
-        double lfo = 0.5 * (1.0 + std::sin(2.0 * juce::MathConstants<double>::pi * lfoPhase));
-        double cutoff = autoWahFrequency + autoWahDepth * lfo * autoWahFrequency;
-        autoWahFilter.setCoefficients(juce::IIRCoefficients::makeBandPass(currentSampleRate, cutoff, 1.0));
+        fadeBank.copyVoicesFrom(voiceBank);
+        fadePatch = patch;
+        programFade.setCurrentAndTargetValue(1.0f);
+        programFade.setTargetValue(0.0f);
+    }
 
-        lfoPhase += lfoPhaseIncrement;
-        if (lfoPhase >= 1.0)
-            lfoPhase -= 1.0;
+    // Switching is only a pointer store.
+    activeProgram.store(&programs[(size_t)program], std::memory_order_release);
+    programToCopy.store(program, std::memory_order_release);
+    currentProgram.store(program, std::memory_order_relaxed);
+    applyPatch(programs[(size_t)program].patch);
+}
+
+void SynthAudioProcessor::mixProgramFade(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool stereo)
+{
+    // In prepared-block-sized pieces, since hosts may send longer blocks than they said.
+    while (numSamples > 0 && programFade.isSmoothing())
+    {
+        const int length = juce::jmin(numSamples, (int)fadeLeft.size());
+        std::fill(fadeLeft.begin(), fadeLeft.begin() + length, 0.0f);
+        std::fill(fadeRight.begin(), fadeRight.begin() + length, 0.0f);
+        fadeBank.render(fadeLeft.data(), stereo ? fadeRight.data() : nullptr, length,
+                        fadePatch.waveType, fadePatch.pulseWidth, fadePatch.bandLimited);
+
+        auto* left = buffer.getWritePointer(0, startSample);
+        auto* right = stereo ? buffer.getWritePointer(1, startSample) : nullptr;
+        for (int i = 0; i < length; ++i)
+        {
+            const float oldShare = programFade.getNextValue();
+            left[i] += (fadeLeft[(size_t)i] - left[i]) * oldShare;
+            if (right != nullptr)
+                right[i] += (fadeRight[(size_t)i] - right[i]) * oldShare;
+        }
+        startSample += length;
+        numSamples -= length;
+    }
+}
+
+void SynthAudioProcessor::handleMidiEvent(const juce::MidiMessage& message)
+{
+    if (message.isNoteOn())
+    {
+        const auto allocation = voiceAllocator.noteOn(message.getNoteNumber());
+        if (allocation.releasedVoice != VoiceAllocator::noVoice)
+            voices[allocation.releasedVoice]->noteOff();
+
+        auto* voice = voices[allocation.voice];
+        if (allocation.stolen)
+            voice->steal();
+        voice->setNote(message.getNoteNumber());
+        voice->setVelocity(message.getVelocity());
+        voice->noteOn();
+    }
+    else if (message.isNoteOff())
+    {
+        const auto voice = voiceAllocator.noteOff(message.getNoteNumber());
+        if (voice != VoiceAllocator::noVoice)
+            voices[voice]->noteOff();
+    }
+    else if (message.isProgramChange())
+    {
+        switchProgram(message.getProgramChangeNumber());
     }
 }
 
+void SynthAudioProcessor::releaseAllNotes()
+{
+    for (int note = 0; note < 128; ++note)
+    {
+        const auto voice = voiceAllocator.noteOff(note);
+        if (voice != VoiceAllocator::noVoice)
+            voices[voice]->noteOff();
+    }
+}
 
 //==============================================================================
 bool SynthAudioProcessor::hasEditor() const
@@ -252,154 +638,126 @@ juce::AudioProcessorEditor* SynthAudioProcessor::createEditor()
 //==============================================================================
 void SynthAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    destData.append("", 1);
-    destData.append(&gain, sizeof(gain));
-    destData.append(&pulseWidth, sizeof(pulseWidth));
-    destData.append(&waveType, sizeof(waveType));
-    destData.append(&attack, sizeof(attack));
-    destData.append(&decay, sizeof(decay));
-    destData.append(&sustain, sizeof(sustain));
-    destData.append(&release, sizeof(release));
-    destData.append(&autoWahFrequency, sizeof(autoWahFrequency));
-    destData.append(&autoWahDepth, sizeof(autoWahDepth));
-    destData.append(&autoWahRate, sizeof(autoWahRate));
-    destData.append(&autoWah, sizeof(autoWah));
+    PluginState::Writer writer(destData, stateTag, stateVersion);
+    // A program switched to moments ago may not have reached the parameters yet.
+    const auto* program = activeProgram.load(std::memory_order_acquire);
+    for (const auto& parameter : stateParameters)
+        writer.add(parameter.key, program != nullptr ? program->values.*parameter.value
+                                                     : parameters.getRawParameterValue(parameter.parameterID)->load());
+    writer.add(maxVoicesKey, (float)getMaxVoices());
+    writer.add(voiceStealingKey, (float)getVoiceStealing());
+    writer.add(renderThreadsKey, (float)numRenderThreads);
 }
 
 void SynthAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
+    // The state replaces whatever program was last switched to.
+    programToCopy.store(-1);
+    activeProgram.store(nullptr);
+
+    if (!PluginState::hasTag(data, sizeInBytes, stateTag))
+    {
+        setLegacyStateInformation(data, sizeInBytes);
+        return;
+    }
+
+    const PluginState::Reader reader(data, sizeInBytes, stateTag);
+    for (int i = 0; i < reader.getNumFields(); ++i)
+    {
+        const auto key = reader.getKey(i);
+        const auto value = reader.getValue(i);
+        for (const auto& parameter : stateParameters)
+            if (parameter.key == key)
+                setParameterValue(parameter.parameterID, value);
+
+        switch (key)
+        {
+        case maxVoicesKey:      setMaxVoices((int)value); break;
+        case voiceStealingKey:  setVoiceStealing((VoiceStealing)juce::jlimit((int)StealOldest, (int)StealSameNote, (int)value)); break;
+        case renderThreadsKey:  setRenderThreads((int)value); break;
+        default:                break;
+        }
+    }
+}
+
+void SynthAudioProcessor::setLegacyStateInformation(const void* data, int sizeInBytes)
+{
+    // The raw layout released before the versioned one: native-endian values in a fixed
+    // order, and nothing else. A state too short for all of them is left alone.
     const char* d = static_cast<const char*>(data);
+    const char* const end = d + juce::jmax(0, sizeInBytes);
+    auto canRead = [&](size_t numBytes) { return d != nullptr && (size_t)(end - d) >= numBytes; };
+    auto read = [&d](auto& value)
+    {
+        std::memcpy(&value, d, sizeof(value));
+        d += sizeof(value);
+    };
+    auto readDouble = [&read]()
+    {
+        double value;
+        read(value);
+        return (float)value;
+    };
+    // The wave type was saved as it is in memory, which is as an int on every compiler we build with.
+    static_assert(sizeof(WaveType) == sizeof(int) && sizeof(bool) == 1, "Legacy layout");
+    auto readInt = [&read]()
+    {
+        int value;
+        read(value);
+        return value;
+    };
+
+    if (!canRead(1 + 9 * sizeof(double) + sizeof(WaveType) + sizeof(bool)))
+        return;
     d += 1;
-    gain = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    pulseWidth = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    waveType = *reinterpret_cast<const WaveType*>(d);
-    d += sizeof(WaveType);
-    attack = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    decay = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    sustain = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    release = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    autoWahFrequency = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    autoWahDepth = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    autoWahRate = *reinterpret_cast<const double*>(d);
-    d += sizeof(double);
-    autoWah = *reinterpret_cast<const bool*>(d);
+    setParameterValue("gain", readDouble());
+    setParameterValue("pulseWidth", readDouble());
+    setParameterValue("waveType", (float)(readInt() - Sine));
+    setParameterValue("attack", readDouble());
+    setParameterValue("decay", readDouble());
+    setParameterValue("sustain", readDouble());
+    setParameterValue("release", readDouble());
+    setParameterValue("autoWahFrequency", readDouble());
+    setParameterValue("autoWahDepth", readDouble());
+    setParameterValue("autoWahRate", readDouble());
+    // Read as a byte, so a damaged one still makes a valid bool.
+    unsigned char flag;
+    read(flag);
+    setParameterValue("autoWah", flag != 0 ? 1.0f : 0.0f);
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
+// Targets that build this processor in as a stage of their own define EMBEDDED_ENGINE=1.
+#if ! EMBEDDED_ENGINE
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new SynthAudioProcessor();
 }
+#endif
 
 
 
 void Voice::setSampleRate(double sampleRate) {
     this->sampleRate = sampleRate;
-    updateAngleDelta();
+    updatePhaseIncrement();
 }
 
-void Voice::setGlobalParameters(double gain, double pulseWidth, WaveType waveType, double attack, double decay, double sustain, double release) {
-    this->gain = gain;
-    this->pulseWidth = pulseWidth;
-    this->waveType = waveType;
-    this->attack = attack;
-    this->decay = decay;
-    this->sustain = sustain;
-    this->release = release;
-    //updateAngleDelta();
-    updateCurrentVolume();
+void Voice::setNote(int newNote) {
+    note = newNote;
+    setFrequency(juce::MidiMessage::getMidiNoteInHertz(note));
+    updatePan();
 }
 
-void Voice::processBlock(juce::AudioBuffer<float>& buffer) {
-    for (int i = 0; i < buffer.getNumSamples(); ++i)
-    {
-        double sample = 0.0;
-        switch (waveType) {
-        case Sine:
-            sample = std::sin(angle);
-            break;
-        case Sawtooth:
-            sample = (angle / juce::MathConstants<double>::pi);
-            sample = sample < 1.0 ? sample : sample - 2.0;
-            break;
-        case Square:
-            sample = angle < juce::MathConstants<double>::twoPi * pulseWidth ? 1.0 : -1.0;
-            break;
-        case Triangle:
-            sample = 2 * angle / juce::MathConstants<double>::pi;
-            if (sample > 1.0)
-                if (sample < 3.0)
-                    sample = 3.0 - sample;
-                else
-                    sample = sample - 4.0;
-            break;
-        }
-        angle += angleDelta;
-        updateCurrentVolume();
-        if (angle >= juce::MathConstants<double>::twoPi)
-            angle -= juce::MathConstants<double>::twoPi;
-
-        auto* firstChannelData = buffer.getWritePointer(0);
-        firstChannelData[i] += static_cast<float>(sample * currentVolume);
-        for (int channel = 1; channel < buffer.getNumChannels(); ++channel)
-        {
-            auto* channelData = buffer.getWritePointer(channel);
-            channelData[i] += firstChannelData[i];
-        }
-    }
+void Voice::updatePhaseIncrement() {
+    bank.setIncrement(index, sampleRate > 0.0 ? (float)(frequency / sampleRate) : 0.0f);
 }
 
-void Voice::updateAngleDelta() {
-	angle = 0.0;
-    auto cyclesPerSample = frequency / sampleRate;
-    angleDelta = cyclesPerSample * 2.0 * juce::MathConstants<double>::pi;
+void Voice::updateGain() {
+    bank.setGain(index, (float)(velocity / 127));
 }
 
-void Voice::updateCurrentVolume() {
-    switch (phase) {
-    case 1:
-        currentPhaseMultiplier = (juce::Time::getMillisecondCounter() - startTimestamp) / (attack * 1000);
-        if (currentPhaseMultiplier >= 1) {
-            currentPhaseMultiplier = 1;
-            phase = 2;
-            startTimestamp = juce::Time::getMillisecondCounter();
-        }
-        break;
-    case 2:
-    {
-        double percent = (juce::Time::getMillisecondCounter() - startTimestamp) / (decay * 1000);
-        //currentPhaseMultiplier = 1 - (percent * (1 - sustain));
-        currentPhaseMultiplier = (1 - percent) * (1 - sustain) + sustain;
-        if (currentPhaseMultiplier <= sustain) {
-            currentPhaseMultiplier = sustain;
-            phase = 3;
-        }
-    }
-    break;
-    case 3:
-        currentPhaseMultiplier = sustain;
-        break;
-    case 4:
-    {
-        double percent = (juce::Time::getMillisecondCounter() - endTimestamp) / (release * 1000);
-        currentPhaseMultiplier = (1 - percent) * sustain;
-        if (currentPhaseMultiplier <= 0) {
-            currentPhaseMultiplier = 0;
-            phase = 0;
-			angle = 0.0;
-        }
-    }
-    break;
-    }
-
-    currentVolume = gain * currentPhaseMultiplier * velocity / 127;
+void Voice::updatePan() {
+    // Two octaves either side of middle C reach the edges at full spread.
+    bank.setPan(index, juce::jlimit(-1.0f, 1.0f, patch.pan + patch.stereoSpread * (float)(note - 60) / 24.0f));
 }
@@ -9,58 +9,118 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+#include "AutoWah.h"
+#include "../Shared/LoadMeter.h"
+#include "../Shared/PluginState.h"
+#include "../Shared/PresetBank.h"
+#include "RenderThreadPool.h"
+#include "VoiceBank.h"
+#include "VoiceAllocator.h"
 
-enum WaveType
+// The parameter values for one block, read once at its start on the audio thread.
+// Voices and the render code only ever see this, never the parameters themselves.
+struct SynthPatch
 {
-    Sine = 1,
-    Sawtooth = 2,
-    Square = 3,
-    Triangle = 4
+    float gain = 0.2512f;
+    float pulseWidth = 0.5f;
+    WaveType waveType = Sine;
+    bool bandLimited = true;
+    AdsrEnvelope::Parameters envelope;
+    float pan = 0.0f;           //-1 to 1
+    float stereoSpread = 0.0f;  //0-1
+    int unisonVoices = 1;       //1 to VoiceBank::maxUnison oscillators per note
+    float unisonDetune = 20.0f; //cents either side
+    float unisonSpread = 0.5f;  //0-1
+    bool autoWah = false;
+    float autoWahFrequency = 700.0f;
+    float autoWahDepth = 0.8f;
+    float autoWahRate = 2.0f;
+    AutoWahMode autoWahMode = LfoWah;
+    float autoWahSensitivity = 4.0f;
+    float autoWahAttack = 0.01f;    //seconds
+    float autoWahRelease = 0.15f;
+};
+
+// One value per parameter, in the parameter layout's order: the live parameters' atomics,
+// or a program's own copy of their raw values.
+template <typename Value>
+struct SynthParameterSet
+{
+    Value gain;
+    Value pulseWidth;
+    Value waveType;
+    Value bandLimited;
+    Value attack;
+    Value decay;
+    Value sustain;
+    Value release;
+    Value envelopeCurve;
+    Value pan;
+    Value stereoSpread;
+    Value unisonVoices;
+    Value unisonDetune;
+    Value unisonSpread;
+    Value autoWah;
+    Value autoWahFrequency;
+    Value autoWahDepth;
+    Value autoWahRate;
+    Value autoWahMode;
+    Value autoWahSensitivity;
+    Value autoWahAttack;
+    Value autoWahRelease;
+};
+
+// A preset in the program table, decoded ahead of time so switching to it is only a pointer.
+struct SynthProgram
+{
+    static constexpr int maxNameBytes = 64;
+
+    char name[maxNameBytes] = {};
+    SynthParameterSet<float> values {};
+    SynthPatch patch;
 };
 
+// Control handle for one lane of the VoiceBank, which holds the audio-rate state.
 class Voice
 {
 public:
-    Voice::Voice() : angle(0.0), angleDelta(0.0), currentVolume(0.0), currentPhaseMultiplier(0.0), phase(0), startTimestamp(0), endTimestamp(0) {}
+    Voice(VoiceBank& bank, const SynthPatch& patch, int index) : bank(bank), patch(patch), index(index) {}
 	~Voice() {}
-	void setFrequency(double newFrequency) { frequency = newFrequency; updateAngleDelta(); }
-	void setVelocity(double newVelocity) { velocity = newVelocity; updateCurrentVolume(); }
-	void noteOn() { startTimestamp = juce::Time::getMillisecondCounter(); phase = 1; angle = 0.0; }
-	void noteOff() { endTimestamp = juce::Time::getMillisecondCounter(); phase = 4; }
+	void setFrequency(double newFrequency) { frequency = newFrequency; updatePhaseIncrement(); }
+	void setNote(int newNote);
+	void setVelocity(double newVelocity) { velocity = newVelocity; updateGain(); }
+	void noteOn() { bank.noteOn(index); }
+	void noteOff() { bank.noteOff(index); }
+	void steal() { bank.steal(index); }
 
 	void setSampleRate(double sampleRate);
-	void setGlobalParameters(double gain, double pulseWidth, WaveType waveType, double attack, double decay, double sustain, double release);
+	// Re-reads the patch's pan and spread, which fan the notes out across the field by key.
+	void updatePan();
 	double getFrequency() const { return frequency; }
-	bool isPlaying() const { return phase != 0; }
-
-	void processBlock(juce::AudioBuffer<float>& buffer);
+	bool isPlaying() const { return bank.isPlaying(index); }
 
 private:
-	void updateAngleDelta();
-	void updateCurrentVolume();
-	double angle = 0.0, angleDelta = 0.0, frequency = 440.0;
-	double velocity = 0;	//0-127
-	double currentPhaseMultiplier = 0;	//0-1
-	double currentVolume = 0;	//0-1
-	int phase = 0; // 1 = attack, 2 = decay, 3 = sustain, 4 = release, 0 = off
-	unsigned int startTimestamp = 0;
-	unsigned int endTimestamp = 0;
+	void updatePhaseIncrement();
+	void updateGain();
 
+	VoiceBank& bank;
+	const SynthPatch& patch;
+	const int index;
+	double frequency = 440.0;
+	double velocity = 0;	//0-127
 	double sampleRate = 0.0;
-	double gain = 0;	//0-1
-	double pulseWidth = 0.5;	//0-1
-	WaveType waveType = Sine;
-	double attack = 0.02;	//seconds
-	double decay = 0.04;	//seconds
-	double sustain = 0.7;	//0-1
-	double release = 0.03;	//seconds
+	int note = 60;
 };
 
 
 //==============================================================================
 /**
 */
-class SynthAudioProcessor : public juce::AudioProcessor
+class SynthAudioProcessor : public juce::AudioProcessor,
+    private juce::Timer
 {
 public:
     //==============================================================================
@@ -97,35 +157,107 @@ public:
     void changeProgramName(int index, const juce::String& newName) override;
 
     //==============================================================================
+    // A PluginState with this tag; states saved in the older raw layout still load.
+    static constexpr juce::uint32 stateTag = PluginState::makeTag("Synt");
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
 
     //==============================================================================
-    void updateAutoWahFilter(double currentTimeInSeconds);
-    void updateAutoWahFilterWithPhase();
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
-    juce::IIRFilter autoWahFilter;
-    double autoWahFrequency = 700.0;
-    double autoWahDepth = 0.8;
-    double autoWahRate = 2.0;
-    bool autoWah = false;
+    // Host-automatable parameters; the editor attaches to these.
+    juce::AudioProcessorValueTreeState parameters;
+
+    //==============================================================================
+    AutoWah autoWah;
+
+    // 1 to VoiceAllocator::maxPolyphony; every voice is preallocated, so this is safe at any time.
+    void setMaxVoices(int newMaxVoices) { voiceAllocator.setMaxVoices(newMaxVoices); }
+    int getMaxVoices() const { return voiceAllocator.getMaxVoices(); }
+    void setVoiceStealing(VoiceStealing policy) { voiceAllocator.setStealingPolicy(policy); }
+    VoiceStealing getVoiceStealing() const { return voiceAllocator.getStealingPolicy(); }
+    // Audio thread only: every held note starts its release, as if its note-off had arrived.
+    void releaseAllNotes();
+
+    // Programs are switched by MIDI program change, on the event's sample, or by the host, at
+    // the start of the next block. Sounding notes carry on under the new program, crossfaded
+    // over programFadeSeconds from a copy of them still rendering the old one. Loading decodes
+    // up to maxPrograms of the bank's presets into a preallocated table; it allocates, so call
+    // it off the audio thread. Returns how many loaded.
+    static constexpr int maxPrograms = 128;
+    static constexpr double programFadeSeconds = 0.005;
+    int loadPrograms(const PresetBank& bank);
+
+    // Opt-in rendering on 0 (the default, audio thread only) to RenderThreadPool::maxThreads
+    // extra threads; only worth it on machines with cores to spare at high polyphony.
+    void setRenderThreads(int numThreads);
+    int getRenderThreads() const { return numRenderThreads; }
+    // Smoothed over recent threaded blocks, for reporting.
+    double getRenderParallelism() const { return renderThreads.getParallelism(); }
+    double getRenderDispatchMicroseconds() const { return renderThreads.getDispatchMicroseconds(); }
+    int getRenderLateRounds() const { return renderThreads.getLateRounds(); }
 
-    double lfoPhase = 0.0;
-    double lfoPhaseIncrement = 0.0;
+    // processBlock's DSP load, and the voices sounding at the end of the last block.
+    LoadMeter loadMeter;
+    int getActiveVoices() const { return activeVoices.load(std::memory_order_relaxed); }
+    int getPeakActiveVoices() const { return peakActiveVoices.load(std::memory_order_relaxed); }
+    void resetPeakActiveVoices() { peakActiveVoices.store(0, std::memory_order_relaxed); }
 
-    int maxVoices = 16;
     juce::OwnedArray<Voice> voices;
-    double gain = 0.2512;
-    double pulseWidth = 0.5;
-    WaveType waveType = Sine;
-    double attack = 0.02;
-    double decay = 0.04;
-    double sustain = 0.7;
-    double release = 0.03;
+    RenderThreadPool renderThreads;
+    VoiceBank voiceBank;
+    VoiceAllocator voiceAllocator;
 
 private:
+    // Raw values of the parameters, cached so the audio thread never looks them up by name.
+    using ParameterValues = SynthParameterSet<std::atomic<float>*>;
+
+    SynthPatch readPatch() const;
+    // The program switched to, until its values have been copied to the parameters, else the parameters.
+    SynthPatch currentPatch() const;
+    // Makes newPatch the one the voices render with.
+    void applyPatch(const SynthPatch& newPatch);
+    void switchProgram(int program);
+    void mixProgramFade(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool stereo);
+    // Copies a switched-to program's values to the parameters on the message thread, only
+    // so the editor and host show them; nothing else waits on it.
+    void timerCallback() override;
+    void setLegacyStateInformation(const void* data, int sizeInBytes);
+    void setParameterValue(const juce::String& parameterID, float value);
+    void renderVoices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, bool stereo);
+    void handleMidiEvent(const juce::MidiMessage& message);
+
     double currentSampleRate = 0.0;
+    int numRenderThreads = 0;
+    std::atomic<int> activeVoices { 0 };
+    std::atomic<int> peakActiveVoices { 0 };
+
+    ParameterValues parameterValues;
+    SynthPatch patch;
+
+    // Only replaced while processing is suspended, so the audio thread reads it freely.
+    std::array<SynthProgram, maxPrograms> programs;
+    int numPrograms = 0;
+    // Set on the audio thread at the switch, cleared once the parameters hold the same values.
+    // While set it alone decides what is rendered, the tail and the saved state, so without a
+    // message loop (the command line and the benchmark) the timer never runs and it never needs to.
+    std::atomic<const SynthProgram*> activeProgram { nullptr };
+    std::atomic<int> programToCopy { -1 };
+    std::atomic<int> currentProgram { 0 };
+    std::atomic<int> requestedProgram { -1 };
+    // Audio thread only: the voices as they were at the last switch, still on the patch they
+    // had then, and their share of the output, falling from 1 to 0 over the crossfade.
+    VoiceBank fadeBank;
+    SynthPatch fadePatch;
+    juce::SmoothedValue<float> programFade { 0.0f };
+    std::vector<float> fadeLeft;
+    std::vector<float> fadeRight;
+    // Gain ramps per sample; pulse width steps every smoothingSubBlock samples while it glides.
+    static constexpr double smoothingSeconds = 0.02;
+    static constexpr int smoothingSubBlock = 32;
+    juce::SmoothedValue<float> gainSmoother;
+    juce::SmoothedValue<float> pulseWidthSmoother;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthAudioProcessor)
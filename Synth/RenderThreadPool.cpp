@@ -0,0 +1,211 @@
+#include "RenderThreadPool.h"
+#include "../Shared/RealtimeSafety.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    // The CPU's spin-wait hint: no system call, and it frees the pipeline for a
+    // hyperthread sibling, which may be the worker being waited on.
+    inline void cpuPause()
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && ! JUCE_MSVC
+        asm volatile ("yield");
+       #endif
+    }
+}
+
+class RenderThreadPool::Worker : public juce::Thread
+{
+public:
+    Worker(RenderThreadPool& pool, int index)
+        : juce::Thread("Synth render worker " + juce::String(index)), pool(pool) {}
+
+    void run() override
+    {
+        auto lastRound = getRound(pool.claims.load(std::memory_order_acquire));
+
+        while (waitForRound(lastRound))
+            while (pool.runNextJob()) {}
+    }
+
+private:
+    // Polls until a new round is published; false once the thread should exit. Nothing
+    // wakes a worker, so publishing a round is one atomic store on the audio thread.
+    bool waitForRound(uint64_t& lastRound)
+    {
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        for (int polls = 0;; ++polls)
+        {
+            const auto current = getRound(pool.claims.load(std::memory_order_acquire));
+            if (current != lastRound)
+            {
+                lastRound = current;
+                return true;
+            }
+
+            cpuPause();
+            if ((polls & 63) == 63)
+            {
+                if (threadShouldExit())
+                    return false;
+
+                // Flat out for about a block, then giving the core up between polls, and
+                // once the host has stopped calling for a while, hardly polling at all.
+                const auto idleTicks = juce::Time::getHighResolutionTicks() - startTicks;
+                if (idleTicks >= pool.parkTicks.load(std::memory_order_relaxed))
+                    juce::Thread::sleep(1);
+                else if (idleTicks >= pool.spinTicks.load(std::memory_order_relaxed))
+                    juce::Thread::yield();
+            }
+        }
+    }
+
+    RenderThreadPool& pool;
+};
+
+RenderThreadPool::RenderThreadPool()
+{
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+    stop();
+}
+
+void RenderThreadPool::start(int numThreads)
+{
+    stop();
+
+    const auto numCpus = juce::jmax(1, juce::SystemStats::getNumCpus());
+    for (int i = 0; i < juce::jlimit(0, maxThreads, numThreads); ++i)
+    {
+        auto* worker = workers.add(new Worker(*this, i));
+
+        // Pinned so each worker keeps its slices' state in its own cache from block to
+        // block. The first core is left to the host.
+        const auto core = (i + 1) % numCpus;
+        if (core < 32)
+            worker->setAffinityMask(1u << core);
+
+        worker->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+void RenderThreadPool::stop()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+    for (auto* worker : workers)
+        worker->stopThread(1000);
+    workers.clear();
+}
+
+void RenderThreadPool::setBlockDuration(double seconds)
+{
+    const auto ticksPerSecond = (double)juce::Time::getHighResolutionTicksPerSecond();
+    spinTicks = (juce::int64)(seconds * ticksPerSecond);
+    parkTicks = (juce::int64)(juce::jmax(seconds, parkSeconds) * ticksPerSecond);
+    deadlineTicks = (juce::int64)(seconds * deadlineFraction * ticksPerSecond);
+}
+
+bool RenderThreadPool::runNextJob()
+{
+    auto current = claims.load(std::memory_order_acquire);
+    int index = 0;
+
+    for (;;)
+    {
+        index = (int)(current & indexMask);
+        if (index >= (int)((current >> 16) & indexMask))
+            return false;
+
+        // Fails if another thread claimed first or a new round began; either way retry
+        // with the fresh value, which is what makes a stale claim impossible.
+        if (claims.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            break;
+    }
+
+    // Workers render part of the caller's block, so they're held to the same rules.
+    const RealtimeSafety::ScopedCheck realtimeCheck;
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    currentJob->run(index);
+    busyTicks.fetch_add(juce::Time::getHighResolutionTicks() - startTicks, std::memory_order_relaxed);
+    numCompleted.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+void RenderThreadPool::run(Job& job, int numJobs)
+{
+    jassert(numJobs >= 0 && (uint64_t)numJobs <= indexMask);
+
+    // With no workers, or for a while after a late round, the caller does every job.
+    if (workers.isEmpty() || soloRounds > 0)
+    {
+        soloRounds = juce::jmax(0, soloRounds - 1);
+        for (int index = 0; index < numJobs; ++index)
+            job.run(index);
+        return;
+    }
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    currentJob = &job;
+    numCompleted.store(0, std::memory_order_relaxed);
+    busyTicks.store(0, std::memory_order_relaxed);
+    ++round;
+    claims.store(round << 32 | (uint64_t)numJobs << 16, std::memory_order_release);
+    const auto dispatchedTicks = juce::Time::getHighResolutionTicks();
+
+    while (runNextJob()) {}
+    const auto drainedTicks = juce::Time::getHighResolutionTicks();
+
+    // Only jobs already running on workers are left, and a started job can't be taken
+    // over, so nothing bounds this wait; the deadline only decides what happens after it.
+    // Up to the deadline the caller spins on the pause hint alone, with no system call.
+    // Past it the round is late, which sends the next rounds to the caller alone, and
+    // the caller yields between polls so a worker preempted on an oversubscribed machine
+    // can finish. That yield is a system call on the audio thread, so builds with
+    // REALTIME_SAFETY_CHECKS report it, as they should a late round.
+    bool late = false;
+    for (int polls = 0; numCompleted.load(std::memory_order_acquire) < numJobs; ++polls)
+    {
+        if (late)
+        {
+            juce::Thread::yield();
+            continue;
+        }
+
+        cpuPause();
+        if ((polls & 63) == 63 && juce::Time::getHighResolutionTicks() - drainedTicks > deadlineTicks)
+            late = true;
+    }
+    const auto endTicks = juce::Time::getHighResolutionTicks();
+
+    if (late)
+    {
+        lateRounds.fetch_add(1, std::memory_order_relaxed);
+        soloRounds = soloRoundsAfterLate;
+    }
+
+    // Only the calling thread writes these, so a plain load and store is enough.
+    auto smooth = [](std::atomic<double>& value, double measured)
+    {
+        value.store(value.load(std::memory_order_relaxed) + 0.05 * (measured - value.load(std::memory_order_relaxed)),
+                    std::memory_order_relaxed);
+    };
+
+    const auto wallTicks = (double)juce::jmax((juce::int64)1, endTicks - startTicks);
+    const auto ticksToMicroseconds = 1.0e6 / (double)juce::Time::getHighResolutionTicksPerSecond();
+    smooth(parallelism, (double)busyTicks.load(std::memory_order_relaxed) / wallTicks);
+    smooth(dispatchMicroseconds, (double)((dispatchedTicks - startTicks) + (endTicks - drainedTicks)) * ticksToMicroseconds);
+}
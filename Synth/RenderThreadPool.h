@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    A small pool of pinned worker threads that the audio thread hands render
+    jobs to, working through the same jobs itself while it waits.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// Jobs are claimed with a single compare-and-swap on a counter that packs the round,
+// the job count and the next index, and workers find a new round by polling that
+// counter, so dispatch neither locks nor signals. Jobs a late worker never picks up
+// are done by the calling thread. A job that has started can't be taken over, since
+// it moves its voices on, so the caller still waits for those however long they take.
+// The deadline doesn't bound that wait: a round that runs past it is counted late and
+// the caller does the next rounds alone, so a descheduled worker costs one late block
+// rather than every block.
+class RenderThreadPool
+{
+public:
+    static constexpr int maxThreads = 15;
+
+    struct Job
+    {
+        virtual ~Job() {}
+        virtual void run(int index) = 0;
+    };
+
+    // Defined with Worker, which the members' destructors need to see.
+    RenderThreadPool();
+    ~RenderThreadPool();
+
+    // Starts numThreads workers, replacing any running ones; 0 leaves only the caller.
+    // Creates threads, so never call this while run() may be in progress.
+    void start(int numThreads);
+    void stop();
+    int getNumThreads() const { return workers.size(); }
+
+    // The host's block length: idle workers spin flat out for about this long, then
+    // yield between polls until parkSeconds pass without a round, then poll every
+    // millisecond. Rounds are late once jobs still run deadlineFraction of it after
+    // the caller has run out of jobs; the caller spins without system calls until then.
+    void setBlockDuration(double seconds);
+    static constexpr double parkSeconds = 0.5;
+    static constexpr double deadlineFraction = 0.25;
+    // Rounds the caller does alone after a late one.
+    static constexpr int soloRoundsAfterLate = 64;
+
+    // Calls job.run(0) to job.run(numJobs - 1) across the workers and the calling
+    // thread, and returns once every call has finished.
+    void run(Job& job, int numJobs);
+
+    // Smoothed over recent rounds; safe to read from any thread. Parallelism is the time
+    // spent in jobs over the wall time of the round, the threads busy on average; only a
+    // benchmark against a single-threaded render gives the speedup.
+    double getParallelism() const { return parallelism.load(std::memory_order_relaxed); }
+    int getLateRounds() const { return lateRounds.load(std::memory_order_relaxed); }
+    // Time the caller spends publishing a round and waking workers, plus waiting for
+    // the last jobs in flight once it has nothing left to claim.
+    double getDispatchMicroseconds() const { return dispatchMicroseconds.load(std::memory_order_relaxed); }
+
+private:
+    class Worker;
+
+    static constexpr uint64_t indexMask = 0xffff;
+    static uint64_t getRound(uint64_t claims) { return claims >> 32; }
+
+    bool runNextJob();
+
+    juce::OwnedArray<Worker> workers;
+    std::atomic<juce::int64> spinTicks { 0 };
+    std::atomic<juce::int64> parkTicks { 0 };
+    juce::int64 deadlineTicks = 0;
+
+    Job* currentJob = nullptr;
+    uint64_t round = 0;
+    int soloRounds = 0;
+    std::atomic<uint64_t> claims { 0 };     // round << 32 | numJobs << 16 | next index
+    std::atomic<int> numCompleted { 0 };
+    std::atomic<juce::int64> busyTicks { 0 };
+
+    std::atomic<double> parallelism { 1.0 };
+    std::atomic<double> dispatchMicroseconds { 0.0 };
+    std::atomic<int> lateRounds { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(RenderThreadPool)
+};
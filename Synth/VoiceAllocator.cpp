@@ -0,0 +1,155 @@
+#include "VoiceAllocator.h"
+
+void VoiceAllocator::reset()
+{
+    noteToVoice.fill(noVoice);
+    voiceNote.fill(-1);
+    released.fill(false);
+    startedPrev.fill(noVoice);
+    startedNext.fill(noVoice);
+    releasedPrev.fill(noVoice);
+    releasedNext.fill(noVoice);
+    started = {};
+    releasedList = {};
+    quietestVoice = noVoice;
+
+    // Pushed in reverse so the lowest voices are handed out first, which keeps the
+    // bank's sounding lanes packed into as few SIMD groups as possible.
+    numFree = 0;
+    for (int voice = maxPolyphony - 1; voice >= 0; --voice)
+        freeVoices[(size_t)numFree++] = voice;
+    numActive = 0;
+}
+
+void VoiceAllocator::append(List& list, std::array<int, maxPolyphony>& prev, std::array<int, maxPolyphony>& next, int voice)
+{
+    prev[(size_t)voice] = list.tail;
+    next[(size_t)voice] = noVoice;
+    if (list.tail != noVoice)
+        next[(size_t)list.tail] = voice;
+    else
+        list.head = voice;
+    list.tail = voice;
+}
+
+void VoiceAllocator::remove(List& list, std::array<int, maxPolyphony>& prev, std::array<int, maxPolyphony>& next, int voice)
+{
+    const auto before = prev[(size_t)voice];
+    const auto after = next[(size_t)voice];
+
+    if (before != noVoice)
+        next[(size_t)before] = after;
+    else
+        list.head = after;
+
+    if (after != noVoice)
+        prev[(size_t)after] = before;
+    else
+        list.tail = before;
+
+    prev[(size_t)voice] = next[(size_t)voice] = noVoice;
+}
+
+void VoiceAllocator::detachNote(int voice)
+{
+    const auto note = voiceNote[(size_t)voice];
+    if (note >= 0 && noteToVoice[(size_t)note] == voice)
+        noteToVoice[(size_t)note] = noVoice;
+    voiceNote[(size_t)voice] = -1;
+
+    if (released[(size_t)voice])
+    {
+        remove(releasedList, releasedPrev, releasedNext, voice);
+        released[(size_t)voice] = false;
+    }
+}
+
+int VoiceAllocator::chooseVoiceToSteal() const
+{
+    if (policy.load() != StealQuietest)
+        return started.head;
+
+    if (quietestVoice != noVoice && voiceNote[(size_t)quietestVoice] >= 0)
+        return quietestVoice;
+
+    return releasedList.head != noVoice ? releasedList.head : started.head;
+}
+
+void VoiceAllocator::markReleased(int voice)
+{
+    released[(size_t)voice] = true;
+    append(releasedList, releasedPrev, releasedNext, voice);
+}
+
+VoiceAllocator::Allocation VoiceAllocator::noteOn(int note)
+{
+    jassert(note >= 0 && note < 128);
+    Allocation allocation;
+    const auto previous = noteToVoice[(size_t)note];
+
+    if (previous != noVoice && policy.load() == StealSameNote)
+    {
+        // A repeated note takes over its own voice.
+        allocation.voice = previous;
+    }
+    else
+    {
+        // Otherwise the old voice rings out alongside the new one, but it must not be
+        // left held, since the next note-off will go to the new voice.
+        if (previous != noVoice && !released[(size_t)previous])
+        {
+            markReleased(previous);
+            allocation.releasedVoice = previous;
+        }
+
+        if (numActive < maxVoices && numFree > 0)
+        {
+            allocation.voice = freeVoices[(size_t)--numFree];
+            ++numActive;
+            append(started, startedPrev, startedNext, allocation.voice);
+            voiceNote[(size_t)allocation.voice] = note;
+            noteToVoice[(size_t)note] = allocation.voice;
+            return allocation;
+        }
+
+        allocation.voice = chooseVoiceToSteal();
+        allocation.stolen = true;
+        // Its level was the old note's, so it's no one's pick until the next block.
+        if (allocation.voice == quietestVoice)
+            quietestVoice = noVoice;
+        if (allocation.releasedVoice == allocation.voice)
+            allocation.releasedVoice = noVoice;
+    }
+
+    detachNote(allocation.voice);
+    remove(started, startedPrev, startedNext, allocation.voice);
+    append(started, startedPrev, startedNext, allocation.voice);
+    voiceNote[(size_t)allocation.voice] = note;
+    noteToVoice[(size_t)note] = allocation.voice;
+    return allocation;
+}
+
+int VoiceAllocator::noteOff(int note)
+{
+    jassert(note >= 0 && note < 128);
+    const auto voice = noteToVoice[(size_t)note];
+    if (voice == noVoice || released[(size_t)voice])
+        return noVoice;
+
+    markReleased(voice);
+    return voice;
+}
+
+void VoiceAllocator::voiceFinished(int voice)
+{
+    jassert(voice >= 0 && voice < maxPolyphony);
+    if (voiceNote[(size_t)voice] < 0)
+        return;
+
+    detachNote(voice);
+    remove(started, startedPrev, startedNext, voice);
+    if (voice == quietestVoice)
+        quietestVoice = noVoice;
+    freeVoices[(size_t)numFree++] = voice;
+    --numActive;
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    Constant-time note-to-voice allocation with voice stealing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+enum VoiceStealing
+{
+    StealOldest = 1,
+    StealQuietest = 2,
+    StealSameNote = 3
+};
+
+// Every array is sized for maxPolyphony up front, so changing the voice limit never
+// allocates. Voices are kept in two intrusive lists: all sounding voices by start
+// time and released voices by release time. Each event touches only list ends and
+// the note table; StealQuietest takes a candidate the caller finds once per block,
+// so it needs no scan either.
+class VoiceAllocator
+{
+public:
+    static constexpr int maxPolyphony = 256;
+    static constexpr int noVoice = -1;
+
+    struct Allocation
+    {
+        int voice = noVoice;
+        bool stolen = false;            // the voice was sounding another note
+        int releasedVoice = noVoice;    // an older voice of the same note that should now release
+    };
+
+    VoiceAllocator() { reset(); }
+    ~VoiceAllocator() {}
+
+    void reset();
+
+    // Safe to call from any thread; takes effect on the next note-on.
+    void setMaxVoices(int newMaxVoices) { maxVoices = juce::jlimit(1, maxPolyphony, newMaxVoices); }
+    int getMaxVoices() const { return maxVoices; }
+    void setStealingPolicy(VoiceStealing newPolicy) { policy = newPolicy; }
+    VoiceStealing getStealingPolicy() const { return policy; }
+    // StealQuietest's pick, from the voices' levels as of the last block. It serves one
+    // steal at most and lapses once its voice ends; without one, StealQuietest takes the
+    // voice released longest ago, then the oldest held one.
+    void setQuietestVoice(int voice) { quietestVoice = voice >= 0 && voice < maxPolyphony ? voice : noVoice; }
+
+    Allocation noteOn(int note);
+    // Returns the voice that should start its release, or noVoice.
+    int noteOff(int note);
+    // Called once the voice's envelope has ended.
+    void voiceFinished(int voice);
+
+    int getNumActiveVoices() const { return numActive; }
+
+private:
+    struct List
+    {
+        int head = noVoice, tail = noVoice;
+    };
+
+    void append(List& list, std::array<int, maxPolyphony>& prev, std::array<int, maxPolyphony>& next, int voice);
+    void remove(List& list, std::array<int, maxPolyphony>& prev, std::array<int, maxPolyphony>& next, int voice);
+    int chooseVoiceToSteal() const;
+    void markReleased(int voice);
+    void detachNote(int voice);
+
+    std::atomic<int> maxVoices { 16 };
+    std::atomic<VoiceStealing> policy { StealOldest };
+    int quietestVoice = noVoice;
+
+    std::array<int, 128> noteToVoice;
+    std::array<int, maxPolyphony> voiceNote;
+    std::array<bool, maxPolyphony> released;
+
+    std::array<int, maxPolyphony> freeVoices;
+    int numFree = 0;
+    int numActive = 0;
+
+    List started, releasedList;
+    std::array<int, maxPolyphony> startedPrev, startedNext;
+    std::array<int, maxPolyphony> releasedPrev, releasedNext;
+};
@@ -0,0 +1,701 @@
+#include "VoiceBank.h"
+#include <limits>
+#include "../Shared/FastMath.h"
+
+namespace
+{
+    using FloatVec = VoiceBank::FloatVec;
+    using PhaseVec = VoiceBank::PhaseVec;
+
+    constexpr uint32_t quarterCycle = 1u << 30;
+    constexpr uint32_t halfCycle = 1u << 31;
+    // Spaces the unison oscillators' start phases by the golden ratio.
+    constexpr uint32_t goldenCycle = 0x9e3779b9u;
+
+    // The top 23 bits of the phase as the mantissa of a float in [1, 2), less one,
+    // so [0, 1) without an integer to float conversion.
+    inline FloatVec toCycles(PhaseVec phase, FloatVec one)
+    {
+        return (one | FastMath::shiftRight<9>(phase)) - one;
+    }
+
+    inline FloatVec triangle(PhaseVec phase, FloatVec one)
+    {
+        const auto x = toCycles(phase + PhaseVec::expand(quarterCycle), one) - FloatVec::expand(0.5f);
+        const auto absX = FloatVec::max(x, FloatVec::expand(0.0f) - x);
+        return one - FloatVec::expand(4.0f) * absX;
+    }
+
+    // sin(2 * pi * phase) as sin(pi / 2 * t) of the folded triangle t.
+    inline FloatVec sine(PhaseVec phase, FloatVec one)
+    {
+        return FastMath::sinHalfPi(triangle(phase, one));
+    }
+
+    template <WaveType type>
+    inline FloatVec oscillator(PhaseVec phase, FloatVec pulseWidth, FloatVec one)
+    {
+        switch (type)
+        {
+        case Sine:
+            return sine(phase, one);
+        case Sawtooth:
+            return FloatVec::expand(2.0f) * toCycles(phase + PhaseVec::expand(halfCycle), one) - one;
+        case Square:
+            return FloatVec::expand(2.0f) * (one & FloatVec::lessThan(toCycles(phase, one), pulseWidth)) - one;
+        case Triangle:
+            return triangle(phase, one);
+        }
+        return FloatVec::expand(0.0f);
+    }
+}
+
+void VoiceBank::prepare(int newNumVoices, double sampleRate, int maximumBlockSize)
+{
+    numVoices = newNumVoices;
+    numGroups = (numVoices + numTailLanes + laneWidth - 1) / laneWidth;
+    numLanes = numGroups * laneWidth;
+    nextTailLane = 0;
+    maxBlockSize = maximumBlockSize;
+    numSlices = juce::jmin(maxSlices, numGroups);
+    envelope.setSampleRate(sampleRate);
+    wavetables.build();
+
+    const auto zero = FloatVec::expand(0.0f);
+    phase.assign((size_t)numGroups, PhaseVec::expand(0));
+    increment.assign((size_t)numGroups, PhaseVec::expand(0));
+    level.assign((size_t)numGroups, zero);
+    envMultiplier.assign((size_t)numGroups, FloatVec::expand(1.0f));
+    envOffset.assign((size_t)numGroups, zero);
+    gain.assign((size_t)numGroups, zero);
+    panLeft.assign((size_t)numGroups, FloatVec::expand(1.0f));
+    panRight.assign((size_t)numGroups, FloatVec::expand(1.0f));
+    activeMask.assign((size_t)numGroups, 0);
+    stage.assign((size_t)numLanes, AdsrEnvelope::Idle);
+    samplesLeft.assign((size_t)numLanes, AdsrEnvelope::sustainLength);
+    segmentTarget.assign((size_t)numLanes, 0.0f);
+    mipLevel.assign((size_t)numLanes, 0);
+    unisonPhase.assign((size_t)(numLanes * unisonGroups), PhaseVec::expand(0));
+    finishedMask.assign((size_t)numGroups, 0);
+    mixLeft.assign((size_t)maxBlockSize, zero);
+    mixRight.assign((size_t)maxBlockSize, zero);
+    sliceBuses.assign((size_t)(2 * numSlices * maxBlockSize), zero);
+    sliceActive.assign((size_t)numSlices, 0);
+}
+
+void VoiceBank::copyVoicesFrom(const VoiceBank& other)
+{
+    jassert(other.numGroups == numGroups && other.maxBlockSize == maxBlockSize);
+    if (other.numGroups != numGroups)
+        return;
+
+    // Same sizes, so none of these reallocate.
+    phase = other.phase;
+    increment = other.increment;
+    level = other.level;
+    envMultiplier = other.envMultiplier;
+    envOffset = other.envOffset;
+    gain = other.gain;
+    panLeft = other.panLeft;
+    panRight = other.panRight;
+    activeMask = other.activeMask;
+    stage = other.stage;
+    samplesLeft = other.samplesLeft;
+    segmentTarget = other.segmentTarget;
+    mipLevel = other.mipLevel;
+    unisonPhase = other.unisonPhase;
+    // Voices that end here were never this bank's to report.
+    std::fill(finishedMask.begin(), finishedMask.end(), 0u);
+    nextTailLane = other.nextTailLane;
+    envelope = other.envelope;
+
+    numUnison = other.numUnison;
+    numUnisonGroups = other.numUnisonGroups;
+    maxUnisonRatio = other.maxUnisonRatio;
+    std::copy(std::begin(other.unisonRatio), std::end(other.unisonRatio), std::begin(unisonRatio));
+    std::copy(std::begin(other.unisonMono), std::end(other.unisonMono), std::begin(unisonMono));
+    std::copy(std::begin(other.unisonLeft), std::end(other.unisonLeft), std::begin(unisonLeft));
+    std::copy(std::begin(other.unisonRight), std::end(other.unisonRight), std::begin(unisonRight));
+}
+
+template <typename Vec>
+typename Vec::ElementType& VoiceBank::lane(std::vector<Vec>& array, int voice)
+{
+    // SIMDRegister is a plain register-sized struct, so its lanes can be addressed as elements.
+    return reinterpret_cast<typename Vec::ElementType*>(array.data())[voice];
+}
+
+template <typename Vec>
+typename Vec::ElementType VoiceBank::lane(const std::vector<Vec>& array, int voice)
+{
+    return reinterpret_cast<const typename Vec::ElementType*>(array.data())[voice];
+}
+
+uint32_t VoiceBank::toPhase(double cycles)
+{
+    // Through int64, so whole cycles wrap the way the accumulator does.
+    return (uint32_t)(juce::int64)std::floor(cycles * 4294967296.0);
+}
+
+void VoiceBank::setIncrement(int voice, float cyclesPerSample)
+{
+    jassert(voice < numVoices);
+    if (voice < numVoices)
+    {
+        lane(increment, voice) = toPhase(cyclesPerSample);
+        mipLevel[(size_t)voice] = WavetableSet::getLevel(cyclesPerSample);
+    }
+}
+
+void VoiceBank::setGain(int voice, float newGain)
+{
+    jassert(voice < numVoices);
+    if (voice < numVoices)
+        lane(gain, voice) = newGain;
+}
+
+void VoiceBank::setPan(int voice, float position)
+{
+    jassert(voice < numVoices);
+    if (voice >= numVoices)
+        return;
+
+    const auto angle = (juce::jlimit(-1.0f, 1.0f, position) + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+    lane(panLeft, voice) = juce::MathConstants<float>::sqrt2 * std::cos(angle);
+    lane(panRight, voice) = juce::MathConstants<float>::sqrt2 * std::sin(angle);
+}
+
+void VoiceBank::noteOn(int voice)
+{
+    jassert(voice < numVoices);
+    if (voice >= numVoices)
+        return;
+
+    // A voice that is still sounding keeps its phases, so retriggering it doesn't click.
+    // A silent one, idle or just stolen, starts them afresh.
+    if (stage[(size_t)voice] == AdsrEnvelope::Idle || lane(level, voice) == 0.0f)
+    {
+        lane(phase, voice) = 0;
+
+        // Spread the unison oscillators' start phases, so they don't begin as one loud peak.
+        for (int i = 0; i < maxUnison; ++i)
+            lane(unisonPhase, voice * unisonGroups * laneWidth + i) = (uint32_t)i * goldenCycle;
+    }
+
+    activeMask[(size_t)(voice / laneWidth)] |= 1u << (voice % laneWidth);
+    startSegment(voice, AdsrEnvelope::Attack);
+}
+
+void VoiceBank::noteOff(int voice)
+{
+    jassert(voice < numVoices);
+    if (voice < numVoices && stage[(size_t)voice] != AdsrEnvelope::Idle)
+        startSegment(voice, AdsrEnvelope::Release);
+}
+
+bool VoiceBank::isPlaying(int voice) const
+{
+    return voice < numVoices && stage[(size_t)voice] != AdsrEnvelope::Idle;
+}
+
+float VoiceBank::getVoiceLevel(int voice) const
+{
+    return isPlaying(voice) ? lane(level, voice) * lane(gain, voice) : 0.0f;
+}
+
+int VoiceBank::getQuietestVoice() const
+{
+    int quietest = -1;
+    auto lowest = std::numeric_limits<float>::max();
+    for (int group = 0; group * laneWidth < numVoices; ++group)
+    {
+        const auto mask = activeMask[(size_t)group];
+        if (mask == 0)
+            continue;
+
+        const auto levels = level[(size_t)group] * gain[(size_t)group];
+        for (int i = 0; i < laneWidth; ++i)
+        {
+            const int voice = group * laneWidth + i;
+            if (voice < numVoices && (mask & (1u << i)) != 0 && stage[(size_t)voice] != AdsrEnvelope::Idle
+                && levels.get((size_t)i) < lowest)
+            {
+                lowest = levels.get((size_t)i);
+                quietest = voice;
+            }
+        }
+    }
+    return quietest;
+}
+
+bool VoiceBank::hasActiveVoices() const
+{
+    for (const auto mask : activeMask)
+        if (mask != 0)
+            return true;
+
+    return false;
+}
+
+void VoiceBank::steal(int voice)
+{
+    jassert(voice < numVoices);
+    if (voice >= numVoices || stage[(size_t)voice] == AdsrEnvelope::Idle)
+        return;
+
+    // Prefer an idle tail lane; with all of them busy, the oldest fade is cut short.
+    int tail = numVoices + nextTailLane;
+    for (int i = 0; i < numTailLanes; ++i)
+    {
+        const auto candidate = numVoices + (nextTailLane + i) % numTailLanes;
+        if (stage[(size_t)candidate] == AdsrEnvelope::Idle)
+        {
+            tail = candidate;
+            break;
+        }
+    }
+    nextTailLane = (tail - numVoices + 1) % numTailLanes;
+
+    lane(phase, tail) = lane(phase, voice);
+    lane(increment, tail) = lane(increment, voice);
+    lane(level, tail) = lane(level, voice);
+    lane(gain, tail) = lane(gain, voice);
+    lane(panLeft, tail) = lane(panLeft, voice);
+    lane(panRight, tail) = lane(panRight, voice);
+    mipLevel[(size_t)tail] = mipLevel[(size_t)voice];
+    for (int r = 0; r < unisonGroups; ++r)
+        unisonPhase[(size_t)(tail * unisonGroups + r)] = unisonPhase[(size_t)(voice * unisonGroups + r)];
+    activeMask[(size_t)(tail / laneWidth)] |= 1u << (tail % laneWidth);
+    startSegment(tail, AdsrEnvelope::FastRelease);
+
+    lane(phase, voice) = 0;
+    lane(level, voice) = 0.0f;
+}
+
+void VoiceBank::setEnvelopeParameters(const AdsrEnvelope::Parameters& parameters)
+{
+    if (parameters == envelope.getParameters())
+        return;
+
+    envelope.setParameters(parameters);
+    for (int voice = 0; voice < numVoices; ++voice)
+        if (stage[(size_t)voice] == AdsrEnvelope::Sustain)
+            startSegment(voice, AdsrEnvelope::Sustain);
+}
+
+void VoiceBank::setUnison(int numOscillators, float detuneCents, float spread)
+{
+    numUnison = juce::jlimit(1, maxUnison, numOscillators);
+    numUnisonGroups = (numUnison + laneWidth - 1) / laneWidth;
+
+    alignas(FloatVec::SIMDRegisterSize) float mono[maxUnison];
+    alignas(FloatVec::SIMDRegisterSize) float left[maxUnison];
+    alignas(FloatVec::SIMDRegisterSize) float right[maxUnison];
+
+    // Equal power: uncorrelated oscillators add as the square root of their count.
+    const auto scale = 1.0f / std::sqrt((float)numUnison);
+    const auto clampedSpread = juce::jlimit(0.0f, 1.0f, spread);
+    float octaves[maxUnison];
+    float panCycles[maxUnison];
+
+    for (int i = 0; i < maxUnison; ++i)
+    {
+        // -1 to 1 across the oscillators that sound, with a lone one in the centre.
+        const auto offset = numUnison > 1 ? 2.0f * (float)i / (float)(numUnison - 1) - 1.0f : 0.0f;
+        octaves[i] = detuneCents * offset / 1200.0f;
+        panCycles[i] = (clampedSpread * offset + 1.0f) * 0.125f;
+    }
+
+    FastMath::exp2(unisonRatio, octaves, maxUnison);
+    FastMath::cos(left, panCycles, maxUnison);
+    FastMath::sin(right, panCycles, maxUnison);
+    maxUnisonRatio = 1.0f;
+
+    for (int i = 0; i < maxUnison; ++i)
+    {
+        const auto sounding = i < numUnison ? scale : 0.0f;
+        mono[i] = sounding;
+        left[i] *= sounding * juce::MathConstants<float>::sqrt2;
+        right[i] *= sounding * juce::MathConstants<float>::sqrt2;
+
+        if (i < numUnison)
+            maxUnisonRatio = juce::jmax(maxUnisonRatio, unisonRatio[i]);
+    }
+
+    for (int r = 0; r < unisonGroups; ++r)
+    {
+        unisonMono[r] = FloatVec::fromRawArray(mono + r * laneWidth);
+        unisonLeft[r] = FloatVec::fromRawArray(left + r * laneWidth);
+        unisonRight[r] = FloatVec::fromRawArray(right + r * laneWidth);
+    }
+}
+
+void VoiceBank::startSegment(int voice, AdsrEnvelope::Stage newStage)
+{
+    auto segment = envelope.getSegment(newStage, lane(level, voice));
+
+    // Zero-length segments (e.g. a 0 s attack) jump straight to their target.
+    while (segment.length == 0 && newStage != AdsrEnvelope::Idle)
+    {
+        lane(level, voice) = segment.target;
+        newStage = AdsrEnvelope::getNextStage(newStage);
+        segment = envelope.getSegment(newStage, segment.target);
+    }
+
+    const auto v = (size_t)voice;
+    stage[v] = newStage;
+    samplesLeft[v] = segment.length;
+    segmentTarget[v] = segment.target;
+    lane(envMultiplier, voice) = segment.multiplier;
+    lane(envOffset, voice) = segment.offset;
+
+    if (newStage == AdsrEnvelope::Idle)
+    {
+        lane(level, voice) = 0.0f;
+        activeMask[(size_t)(voice / laneWidth)] &= ~(1u << (voice % laneWidth));
+
+        if (voice < numVoices)
+            finishedMask[(size_t)(voice / laneWidth)] |= 1u << (voice % laneWidth);
+    }
+}
+
+int VoiceBank::samplesUntilNextSegment(int group) const
+{
+    int samples = AdsrEnvelope::sustainLength;
+    for (int voice = group * laneWidth; voice < (group + 1) * laneWidth; ++voice)
+        samples = juce::jmin(samples, samplesLeft[(size_t)voice]);
+    return samples;
+}
+
+void VoiceBank::advanceEnvelopes(int group, int numSamples)
+{
+    for (int voice = group * laneWidth; voice < (group + 1) * laneWidth; ++voice)
+        advanceEnvelope(voice, numSamples);
+}
+
+void VoiceBank::advanceEnvelope(int voice, int numSamples)
+{
+    const auto v = (size_t)voice;
+    if (stage[v] == AdsrEnvelope::Idle || stage[v] == AdsrEnvelope::Sustain)
+        return;
+
+    samplesLeft[v] -= numSamples;
+    if (samplesLeft[v] > 0)
+        return;
+
+    // Snap, so the geometric segments end exactly where the next one expects to start.
+    lane(level, voice) = segmentTarget[v];
+    startSegment(voice, AdsrEnvelope::getNextStage((AdsrEnvelope::Stage)stage[v]));
+}
+
+void VoiceBank::render(float* left, float* right, int numSamples, WaveType waveType, float pulseWidth, bool bandLimited)
+{
+    jassert(maxBlockSize > 0);
+    if (maxBlockSize <= 0)
+        return;
+
+    // Hosts may exceed the block size they announced, so work in scratch-sized chunks.
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+    {
+        const RenderSettings settings { juce::jmin(maxBlockSize, numSamples - start), waveType, pulseWidth, bandLimited, right != nullptr };
+        renderChunk(left + start, right != nullptr ? right + start : nullptr, settings);
+    }
+}
+
+void VoiceBank::renderChunk(float* left, float* right, const RenderSettings& settings)
+{
+    int numActiveGroups = 0;
+    for (int group = 0; group < numGroups; ++group)
+        if (activeMask[(size_t)group] != 0)
+            ++numActiveGroups;
+
+    if (numActiveGroups == 0)
+        return;
+
+    // With only a few groups sounding, waking the workers costs more than it saves.
+    if (pool != nullptr && pool->getNumThreads() > 0 && numActiveGroups >= minGroupsForThreads)
+    {
+        renderThreaded(left, right, settings);
+        return;
+    }
+
+    const auto zero = FloatVec::expand(0.0f);
+    for (int i = 0; i < settings.numSamples; ++i)
+        mixLeft[(size_t)i] = zero;
+    if (settings.stereo)
+        for (int i = 0; i < settings.numSamples; ++i)
+            mixRight[(size_t)i] = zero;
+
+    for (int group = 0; group < numGroups; ++group)
+        if (activeMask[(size_t)group] != 0)
+            renderGroup(group, settings, mixLeft.data(), mixRight.data());
+
+    for (int i = 0; i < settings.numSamples; ++i)
+        left[i] += mixLeft[(size_t)i].sum();
+    if (settings.stereo)
+        for (int i = 0; i < settings.numSamples; ++i)
+            right[i] += mixRight[(size_t)i].sum();
+}
+
+void VoiceBank::renderThreaded(float* left, float* right, const RenderSettings& settings)
+{
+    struct SliceJob : public RenderThreadPool::Job
+    {
+        SliceJob(VoiceBank& bank, const RenderSettings& settings) : bank(bank), settings(settings) {}
+        void run(int slice) override { bank.renderSlice(slice, settings); }
+
+        VoiceBank& bank;
+        const RenderSettings& settings;
+    };
+
+    SliceJob job(*this, settings);
+    pool->run(job, numSlices);
+
+    const auto zero = FloatVec::expand(0.0f);
+    for (int i = 0; i < settings.numSamples; ++i)
+        mixLeft[(size_t)i] = mixRight[(size_t)i] = zero;
+
+    for (int slice = 0; slice < numSlices; ++slice)
+    {
+        if (sliceActive[(size_t)slice] == 0)
+            continue;
+
+        const auto* busLeft = sliceBuses.data() + (size_t)(2 * slice * maxBlockSize);
+        const auto* busRight = busLeft + maxBlockSize;
+        for (int i = 0; i < settings.numSamples; ++i)
+            mixLeft[(size_t)i] += busLeft[i];
+        if (settings.stereo)
+            for (int i = 0; i < settings.numSamples; ++i)
+                mixRight[(size_t)i] += busRight[i];
+    }
+
+    for (int i = 0; i < settings.numSamples; ++i)
+        left[i] += mixLeft[(size_t)i].sum();
+    if (settings.stereo)
+        for (int i = 0; i < settings.numSamples; ++i)
+            right[i] += mixRight[(size_t)i].sum();
+}
+
+void VoiceBank::renderSlice(int slice, const RenderSettings& settings)
+{
+    auto* busLeft = sliceBuses.data() + (size_t)(2 * slice * maxBlockSize);
+    auto* busRight = busLeft + maxBlockSize;
+    bool anyActive = false;
+
+    // Interleaved, since the allocator packs the sounding voices into the lowest groups.
+    for (int group = slice; group < numGroups; group += numSlices)
+    {
+        if (activeMask[(size_t)group] == 0)
+            continue;
+
+        if (!anyActive)
+        {
+            const auto zero = FloatVec::expand(0.0f);
+            for (int i = 0; i < settings.numSamples; ++i)
+                busLeft[i] = busRight[i] = zero;
+            anyActive = true;
+        }
+
+        renderGroup(group, settings, busLeft, busRight);
+    }
+
+    sliceActive[(size_t)slice] = anyActive ? 1 : 0;
+}
+
+void VoiceBank::renderGroup(int group, const RenderSettings& settings, FloatVec* busLeft, FloatVec* busRight)
+{
+    if (settings.bandLimited && settings.stereo)
+        dispatchGroup<true, true>(group, settings, busLeft, busRight);
+    else if (settings.bandLimited)
+        dispatchGroup<true, false>(group, settings, busLeft, busRight);
+    else if (settings.stereo)
+        dispatchGroup<false, true>(group, settings, busLeft, busRight);
+    else
+        dispatchGroup<false, false>(group, settings, busLeft, busRight);
+}
+
+template <bool bandLimited, bool stereo>
+void VoiceBank::dispatchGroup(int group, const RenderSettings& settings, FloatVec* busLeft, FloatVec* busRight)
+{
+    const auto n = settings.numSamples;
+    const auto pw = settings.pulseWidth;
+
+    if (numUnison > 1)
+    {
+        switch (settings.waveType)
+        {
+        case Sine:      renderUnison<Sine, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+        case Sawtooth:  renderUnison<Sawtooth, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+        case Square:    renderUnison<Square, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+        case Triangle:  renderUnison<Triangle, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+        }
+        return;
+    }
+
+    switch (settings.waveType)
+    {
+    case Sine:      renderOscillators<Sine, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+    case Sawtooth:  renderOscillators<Sawtooth, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+    case Square:    renderOscillators<Square, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+    case Triangle:  renderOscillators<Triangle, bandLimited, stereo>(group, n, pw, busLeft, busRight); break;
+    }
+}
+
+template <WaveType type>
+float VoiceBank::readWavetable(int tableLevel, uint32_t p, uint32_t pulseWidth) const
+{
+    switch (type)
+    {
+    case Sine:
+        return WavetableSet::read(wavetables.getSine(), p);
+    case Sawtooth:
+        return WavetableSet::read(wavetables.getRamp(tableLevel), p + halfCycle);
+    case Square:
+    {
+        // Pulse from two ramps: +1 below the pulse width, -1 above it.
+        const auto* ramp = wavetables.getRamp(tableLevel);
+        const auto offset = 2.0f * (float)pulseWidth / 4294967296.0f - 1.0f;
+        return WavetableSet::read(ramp, p - pulseWidth) - WavetableSet::read(ramp, p) + offset;
+    }
+    case Triangle:
+        return WavetableSet::read(wavetables.getTriangle(tableLevel), p);
+    }
+    return 0.0f;
+}
+
+template <WaveType type>
+VoiceBank::FloatVec VoiceBank::readWavetables(int group, PhaseVec phase, uint32_t pulseWidth) const
+{
+    // The table differs per lane, so the reads are a scalar gather.
+    alignas(FloatVec::SIMDRegisterSize) uint32_t phases[laneWidth];
+    alignas(FloatVec::SIMDRegisterSize) float samples[laneWidth];
+    phase.copyToRawArray(phases);
+
+    for (int i = 0; i < laneWidth; ++i)
+        samples[i] = readWavetable<type>(mipLevel[(size_t)(group * laneWidth + i)], phases[i], pulseWidth);
+
+    return FloatVec::fromRawArray(samples);
+}
+
+template <WaveType type>
+VoiceBank::FloatVec VoiceBank::readWavetablesAtLevel(int tableLevel, PhaseVec phase, uint32_t pulseWidth) const
+{
+    alignas(FloatVec::SIMDRegisterSize) uint32_t phases[laneWidth];
+    alignas(FloatVec::SIMDRegisterSize) float samples[laneWidth];
+    phase.copyToRawArray(phases);
+
+    for (int i = 0; i < laneWidth; ++i)
+        samples[i] = readWavetable<type>(tableLevel, phases[i], pulseWidth);
+
+    return FloatVec::fromRawArray(samples);
+}
+
+template <WaveType type, bool bandLimited, bool stereo>
+void VoiceBank::renderOscillators(int group, int numSamples, float pulseWidth, FloatVec* busLeft, FloatVec* busRight)
+{
+    const auto one = FloatVec::expand(1.0f);
+    const auto pw = FloatVec::expand(pulseWidth);
+    const auto pulsePhase = toPhase(pulseWidth);
+    const auto g = (size_t)group;
+    const auto inc = increment[g];
+    const auto amp = gain[g];
+    const auto ampLeft = stereo ? amp * panLeft[g] : amp;
+    const auto ampRight = amp * panRight[g];
+    auto p = phase[g];
+
+    // Runs up to the next envelope segment boundary of any voice in the group,
+    // so the inner loop is the same multiply-add for every lane.
+    for (int start = 0; start < numSamples && activeMask[g] != 0;)
+    {
+        const int length = juce::jmin(numSamples - start, samplesUntilNextSegment(group));
+        const auto mul = envMultiplier[g];
+        const auto add = envOffset[g];
+        auto env = level[g];
+
+        for (int i = start; i < start + length; ++i)
+        {
+            const auto sample = bandLimited ? readWavetables<type>(group, p, pulsePhase)
+                                            : oscillator<type>(p, pw, one);
+            const auto voiced = sample * env;
+            busLeft[i] = FloatVec::multiplyAdd(busLeft[i], voiced, ampLeft);
+            if (stereo)
+                busRight[i] = FloatVec::multiplyAdd(busRight[i], voiced, ampRight);
+            env = FloatVec::multiplyAdd(add, env, mul);
+            p += inc;
+        }
+
+        phase[g] = p;
+        level[g] = env;
+        advanceEnvelopes(group, length);
+        start += length;
+    }
+}
+
+template <WaveType type, bool bandLimited, bool stereo>
+void VoiceBank::renderUnison(int group, int numSamples, float pulseWidth, FloatVec* busLeft, FloatVec* busRight)
+{
+    const auto one = FloatVec::expand(1.0f);
+    const auto pw = FloatVec::expand(pulseWidth);
+    const auto pulsePhase = toPhase(pulseWidth);
+
+    // A voice at a time, with its oscillators across the lanes. The bus lanes are summed
+    // at the end of the chunk, so the lane an oscillator lands on doesn't matter.
+    for (int voice = group * laneWidth; voice < (group + 1) * laneWidth; ++voice)
+    {
+        const auto v = (size_t)voice;
+        if (stage[v] == AdsrEnvelope::Idle)
+            continue;
+
+        // The highest oscillator picks the table, so none of them alias.
+        const auto cyclesPerSample = (double)lane(increment, voice) / 4294967296.0;
+        const auto tableLevel = WavetableSet::getLevel((float)cyclesPerSample * maxUnisonRatio);
+        const auto voiceGain = lane(gain, voice);
+        alignas(FloatVec::SIMDRegisterSize) uint32_t increments[unisonGroups * laneWidth];
+        PhaseVec inc[unisonGroups];
+        FloatVec ampLeft[unisonGroups], ampRight[unisonGroups];
+
+        for (int i = 0; i < numUnisonGroups * laneWidth; ++i)
+            increments[i] = toPhase(cyclesPerSample * unisonRatio[i]);
+
+        for (int r = 0; r < numUnisonGroups; ++r)
+        {
+            inc[r] = PhaseVec::fromRawArray(increments + r * laneWidth);
+            ampLeft[r] = stereo ? unisonLeft[r] * FloatVec::expand(voiceGain * lane(panLeft, voice))
+                                : unisonMono[r] * FloatVec::expand(voiceGain);
+            ampRight[r] = unisonRight[r] * FloatVec::expand(voiceGain * lane(panRight, voice));
+        }
+
+        auto* p = unisonPhase.data() + v * unisonGroups;
+
+        for (int start = 0; start < numSamples && stage[v] != AdsrEnvelope::Idle;)
+        {
+            const int length = juce::jmin(numSamples - start, samplesLeft[v]);
+            const auto mul = lane(envMultiplier, voice);
+            const auto add = lane(envOffset, voice);
+            auto env = lane(level, voice);
+
+            for (int i = start; i < start + length; ++i)
+            {
+                const auto envelopeLevel = FloatVec::expand(env);
+                for (int r = 0; r < numUnisonGroups; ++r)
+                {
+                    const auto sample = bandLimited ? readWavetablesAtLevel<type>(tableLevel, p[r], pulsePhase)
+                                                    : oscillator<type>(p[r], pw, one);
+                    const auto voiced = sample * envelopeLevel;
+                    busLeft[i] = FloatVec::multiplyAdd(busLeft[i], voiced, ampLeft[r]);
+                    if (stereo)
+                        busRight[i] = FloatVec::multiplyAdd(busRight[i], voiced, ampRight[r]);
+                    p[r] += inc[r];
+                }
+                env = add + env * mul;
+            }
+
+            // The voice's own phase keeps time too, so switching unison off carries on
+            // from where the note has got to rather than from where unison started.
+            lane(level, voice) = env;
+            lane(phase, voice) += lane(increment, voice) * (uint32_t)length;
+            advanceEnvelope(voice, length);
+            start += length;
+        }
+    }
+}
@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    VoiceBank keeps the per-voice oscillator and envelope state in
+    structure-of-arrays form and renders SIMDRegister-width groups of voices
+    at once in float32.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "Envelope.h"
+#include "RenderThreadPool.h"
+#include "Wavetable.h"
+
+class VoiceBank
+{
+public:
+    using FloatVec = juce::dsp::SIMDRegister<float>;
+    // 32-bit fixed-point phase, 2^32 to the cycle, so it wraps for free on overflow.
+    using PhaseVec = FloatVec::vMaskType;
+    static constexpr int laneWidth = (int)FloatVec::SIMDNumElements;
+
+    VoiceBank() { setUnison(1, 0.0f, 0.0f); }
+    ~VoiceBank() {}
+
+    // Extra lanes, beyond the voices, that stolen notes fade out on.
+    static constexpr int numTailLanes = 2 * laneWidth;
+    // Threaded renders split the groups into this many interleaved slices.
+    static constexpr int maxSlices = 16;
+    // Fewer sounding groups than this render on the calling thread alone.
+    static constexpr int minGroupsForThreads = 8;
+    // Detuned oscillators per voice, run laneWidth at a time.
+    static constexpr int maxUnison = 16;
+    static constexpr int unisonGroups = (maxUnison + laneWidth - 1) / laneWidth;
+
+    // Allocates every array, so call this from prepareToPlay, never from the audio thread.
+    void prepare(int numVoices, double sampleRate, int maximumBlockSize);
+    // Takes over other's voices exactly as they are, envelope and unison settings included,
+    // so they can go on rendering here under other settings. Both banks must have been
+    // prepared with the same voice count and block size; it only copies, so it is audio-thread safe.
+    void copyVoicesFrom(const VoiceBank& other);
+    int getNumVoices() const { return numVoices; }
+
+    // Large voice counts are then rendered on the pool's workers as well as the
+    // calling thread. The pool must outlive its use here; nullptr renders on the
+    // caller only.
+    void setThreadPool(RenderThreadPool* newPool) { pool = newPool; }
+
+    void setIncrement(int voice, float cyclesPerSample);
+    void setGain(int voice, float gain);
+    // -1 (left) to 1 (right), constant power. Centre keeps unity gain on both sides,
+    // so a centred stereo render matches the mono one.
+    void setPan(int voice, float position);
+    void noteOn(int voice);
+    void noteOff(int voice);
+    bool isPlaying(int voice) const;
+    // The envelope level times the gain, as of the last rendered sample; 0 once it has ended.
+    float getVoiceLevel(int voice) const;
+    // The sounding voice with the lowest of those levels, or -1 with none sounding. It
+    // looks at every group, so call it once per block rather than per event.
+    int getQuietestVoice() const;
+    // False once every voice and tail lane has reached the end of its envelope.
+    bool hasActiveVoices() const;
+    // Moves the voice's current note onto a tail lane with a short fade-out and
+    // silences the voice, so a new note can start on it straight away.
+    void steal(int voice);
+
+    // Calls callback(voice) for each voice whose envelope ended since the last call.
+    template <typename Callback>
+    void takeFinishedVoices(Callback&& callback)
+    {
+        for (int group = 0; group < numGroups; ++group)
+        {
+            auto& finished = finishedMask[(size_t)group];
+            if (finished == 0)
+                continue;
+
+            for (int i = 0; i < laneWidth; ++i)
+                if ((finished & (1u << i)) != 0)
+                    callback(group * laneWidth + i);
+            finished = 0;
+        }
+    }
+
+    // Takes effect from the next segment; voices already in sustain glide to the new level.
+    void setEnvelopeParameters(const AdsrEnvelope::Parameters& parameters);
+
+    // 1 to maxUnison oscillators per voice, spread evenly over +-detuneCents and across
+    // the stereo field by spread (0-1). Doesn't allocate, so it's fine per block.
+    void setUnison(int numOscillators, float detuneCents, float spread);
+
+    // Adds the sum of all voices to left, and with right non-null, pans each voice
+    // between the two; a null right renders a mono bus and ignores the pan.
+    // bandLimited selects the wavetable oscillators instead of the naive shapes. Any
+    // length is fine; it is rendered in chunks of the prepared block size.
+    void render(float* left, float* right, int numSamples, WaveType waveType, float pulseWidth, bool bandLimited);
+
+private:
+    struct RenderSettings
+    {
+        int numSamples;
+        WaveType waveType;
+        float pulseWidth;
+        bool bandLimited;
+        bool stereo;
+    };
+
+    void renderChunk(float* left, float* right, const RenderSettings& settings);
+    void renderThreaded(float* left, float* right, const RenderSettings& settings);
+    void renderSlice(int slice, const RenderSettings& settings);
+    void renderGroup(int group, const RenderSettings& settings, FloatVec* busLeft, FloatVec* busRight);
+    template <bool bandLimited, bool stereo>
+    void dispatchGroup(int group, const RenderSettings& settings, FloatVec* busLeft, FloatVec* busRight);
+    template <WaveType type, bool bandLimited, bool stereo>
+    void renderOscillators(int group, int numSamples, float pulseWidth, FloatVec* busLeft, FloatVec* busRight);
+    template <WaveType type, bool bandLimited, bool stereo>
+    void renderUnison(int group, int numSamples, float pulseWidth, FloatVec* busLeft, FloatVec* busRight);
+    template <WaveType type>
+    FloatVec readWavetables(int group, PhaseVec phase, uint32_t pulseWidth) const;
+    template <WaveType type>
+    FloatVec readWavetablesAtLevel(int tableLevel, PhaseVec phase, uint32_t pulseWidth) const;
+    template <WaveType type>
+    float readWavetable(int tableLevel, uint32_t phase, uint32_t pulseWidth) const;
+
+    int samplesUntilNextSegment(int group) const;
+    void advanceEnvelopes(int group, int numSamples);
+    void advanceEnvelope(int voice, int numSamples);
+    void startSegment(int voice, AdsrEnvelope::Stage stage);
+
+    template <typename Vec>
+    static typename Vec::ElementType& lane(std::vector<Vec>& array, int voice);
+    template <typename Vec>
+    static typename Vec::ElementType lane(const std::vector<Vec>& array, int voice);
+    static uint32_t toPhase(double cycles);
+
+    int numVoices = 0;
+    int numLanes = 0;
+    int numGroups = 0;
+    int nextTailLane = 0;
+    int maxBlockSize = 0;
+    int numSlices = 0;
+    RenderThreadPool* pool = nullptr;
+    AdsrEnvelope envelope;
+    WavetableSet wavetables;
+
+    // One FloatVec per group of laneWidth voices; std::vector honours the register alignment.
+    // During a threaded render each group, and its entries below, is only touched by
+    // the thread rendering its slice.
+    std::vector<PhaseVec> phase;
+    std::vector<PhaseVec> increment;    // per sample; pitch changes leave the phase alone
+    std::vector<FloatVec> level;        // envelope, 0-1
+    std::vector<FloatVec> envMultiplier;
+    std::vector<FloatVec> envOffset;
+    std::vector<FloatVec> gain;         // master gain * velocity
+    std::vector<FloatVec> panLeft;
+    std::vector<FloatVec> panRight;
+    std::vector<uint32_t> activeMask;   // one bit per lane, so silent groups are skipped
+
+    // Per voice, only touched at segment boundaries.
+    std::vector<int> stage;             // AdsrEnvelope::Stage
+    std::vector<int> samplesLeft;
+    std::vector<float> segmentTarget;
+    std::vector<int> mipLevel;          // WavetableSet level for the voice's increment
+
+    std::vector<uint32_t> finishedMask; // per group, voices whose envelope ended
+
+    // Unison: unisonGroups registers of oscillator phases per lane, and per-oscillator
+    // settings shared by every voice. Lanes past numUnison have zero gain.
+    int numUnison = 1;
+    int numUnisonGroups = 1;
+    float maxUnisonRatio = 1.0f;
+    std::vector<PhaseVec> unisonPhase;
+    float unisonRatio[maxUnison];           // of the voice's increment
+    FloatVec unisonMono[unisonGroups];      // gains, with the loudness kept level
+    FloatVec unisonLeft[unisonGroups];
+    FloatVec unisonRight[unisonGroups];
+
+    // Per sample, one lane per voice of a group; lanes are summed once per sample
+    // at the end of the chunk, whatever the voice count.
+    std::vector<FloatVec> mixLeft;
+    std::vector<FloatVec> mixRight;
+    // Left then right bus for each slice, summed into the mix in slice order so the
+    // result doesn't depend on which thread rendered what.
+    std::vector<FloatVec> sliceBuses;
+    std::vector<uint8_t> sliceActive;
+};
@@ -0,0 +1,69 @@
+#include "Wavetable.h"
+
+namespace
+{
+    int getNumHarmonics(int level)
+    {
+        // 0.5 / 2^(level - numLevels) harmonics fit below Nyquist; the table size caps level 0.
+        return juce::jmin(WavetableSet::tableSize / 2 - 1, 1 << (WavetableSet::numLevels - 1 - level));
+    }
+}
+
+void WavetableSet::build()
+{
+    if (isBuilt())
+        return;
+
+    tables.assign((size_t)(numTables * stride), 0.0f);
+
+    // Harmonic n at sample i is sin(2 pi n i / N) = sinLookup[n * i mod N], so the
+    // additive sums below need no trig calls.
+    std::vector<double> sinLookup((size_t)tableSize);
+    for (int i = 0; i < tableSize; ++i)
+        sinLookup[(size_t)i] = std::sin(juce::MathConstants<double>::twoPi * i / tableSize);
+
+    std::vector<double> ramp((size_t)tableSize, 0.0);
+    std::vector<double> triangle((size_t)tableSize, 0.0);
+    int harmonicsSoFar = 0;
+
+    auto store = [this](int table, const std::vector<double>& source)
+    {
+        auto* destination = tables.data() + (size_t)(table * stride);
+        for (int i = 0; i < tableSize; ++i)
+            destination[i] = (float)source[(size_t)i];
+        destination[tableSize] = destination[0];
+    };
+
+    // Each level only adds harmonics to the one above it, so build from the top down.
+    for (int level = numLevels - 1; level >= 0; --level)
+    {
+        for (int n = harmonicsSoFar + 1; n <= getNumHarmonics(level); ++n)
+        {
+            const auto rampAmplitude = -2.0 / (juce::MathConstants<double>::pi * n);
+            const auto triangleAmplitude = (n % 2 == 0) ? 0.0
+                : ((n / 2) % 2 == 0 ? 8.0 : -8.0) / (juce::MathConstants<double>::pi * juce::MathConstants<double>::pi * n * n);
+
+            for (int i = 0; i < tableSize; ++i)
+            {
+                const auto s = sinLookup[(size_t)((n * i) % tableSize)];
+                ramp[(size_t)i] += rampAmplitude * s;
+                triangle[(size_t)i] += triangleAmplitude * s;
+            }
+        }
+        harmonicsSoFar = juce::jmax(harmonicsSoFar, getNumHarmonics(level));
+
+        store(rampTables + level, ramp);
+        store(triangleTables + level, triangle);
+    }
+
+    store(sineTable, sinLookup);
+}
+
+int WavetableSet::getLevel(float cyclesPerSample)
+{
+    if (cyclesPerSample <= 0.0f)
+        return 0;
+
+    const auto level = (int)std::ceil(std::log2(cyclesPerSample)) + numLevels;
+    return juce::jlimit(0, numLevels - 1, level);
+}
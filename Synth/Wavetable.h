@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    Band-limited, per-octave wavetables for the Synth's oscillator shapes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+enum WaveType
+{
+    Sine = 1,
+    Sawtooth = 2,
+    Square = 3,
+    Triangle = 4
+};
+
+// Level k holds the harmonics that stay below Nyquist for phase increments up to
+// 2^(k - numLevels), so the tables don't depend on the sample rate. Square has no
+// table of its own; it is the difference of two ramp reads.
+class WavetableSet
+{
+public:
+    static constexpr int tableBits = 11;
+    static constexpr int tableSize = 1 << tableBits;
+    static constexpr int numLevels = 11;
+
+    WavetableSet() {}
+    ~WavetableSet() {}
+
+    // Allocates and fills the tables; call from prepareToPlay.
+    void build();
+    bool isBuilt() const { return !tables.empty(); }
+
+    static int getLevel(float cyclesPerSample);
+
+    const float* getSine() const { return getTable(sineTable, 0); }
+    // Rising ramp, -1 at phase 0 to 1 at phase 1.
+    const float* getRamp(int level) const { return getTable(rampTables, level); }
+    const float* getTriangle(int level) const { return getTable(triangleTables, level); }
+
+    // Linear interpolation at a 32-bit fixed-point phase, 2^32 to the cycle: the top
+    // bits are the index and the rest the fraction, so any phase is in range.
+    static float read(const float* table, uint32_t phase)
+    {
+        constexpr int fractionBits = 32 - tableBits;
+        const auto index = (int)(phase >> fractionBits);
+        const auto frac = (float)(phase & ((1u << fractionBits) - 1)) * (1.0f / (float)(1u << fractionBits));
+        return table[index] + frac * (table[index + 1] - table[index]);
+    }
+
+private:
+    static constexpr int stride = tableSize + 1;    // one guard point for interpolation
+    static constexpr int sineTable = 0;
+    static constexpr int rampTables = 1;
+    static constexpr int triangleTables = rampTables + numLevels;
+    static constexpr int numTables = triangleTables + numLevels;
+
+    const float* getTable(int first, int level) const { return tables.data() + (size_t)((first + level) * stride); }
+
+    std::vector<float> tables;
+};
@@ -11,7 +11,7 @@
 
 //==============================================================================
 TremoloAudioProcessorEditor::TremoloAudioProcessorEditor(TremoloAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p)
+    : AudioProcessorEditor(&p), audioProcessor(p), loadDisplay(p.loadMeter)
 {
     addAndMakeVisible(depthSlider);
     depthSlider.setRange(0.0, 1.0);
@@ -23,6 +23,15 @@ TremoloAudioProcessorEditor::TremoloAudioProcessorEditor(TremoloAudioProcessor&
     rateSlider.setValue(*audioProcessor.rate);
     rateSlider.onValueChange = [this] { *audioProcessor.rate = rateSlider.getValue(); };
 
+    addAndMakeVisible(syncButton);
+    syncButton.setToggleState(*audioProcessor.tempoSync, juce::dontSendNotification);
+    syncButton.onClick = [this] { *audioProcessor.tempoSync = syncButton.getToggleState(); };
+
+    addAndMakeVisible(divisionSelector);
+    divisionSelector.addItemList(audioProcessor.syncDivision->choices, 1);
+    divisionSelector.setSelectedItemIndex(audioProcessor.syncDivision->getIndex(), juce::dontSendNotification);
+    divisionSelector.onChange = [this] { *audioProcessor.syncDivision = divisionSelector.getSelectedItemIndex(); };
+
     addAndMakeVisible(depthLabel);
     depthLabel.setText("Depth", juce::dontSendNotification);
     depthLabel.attachToComponent(&depthSlider, true);
@@ -31,7 +40,9 @@ TremoloAudioProcessorEditor::TremoloAudioProcessorEditor(TremoloAudioProcessor&
     rateLabel.setText("Rate", juce::dontSendNotification);
     rateLabel.attachToComponent(&rateSlider, true);
 
-    setSize(400, 150);
+    addAndMakeVisible(loadDisplay);
+
+    setSize(400, 180);
 }
 
 TremoloAudioProcessorEditor::~TremoloAudioProcessorEditor() {}
@@ -47,4 +58,7 @@ void TremoloAudioProcessorEditor::resized()
 {
     depthSlider.setBounds(40, 30, 320, 20);
     rateSlider.setBounds(40, 60, 320, 20);
+    syncButton.setBounds(40, 90, 150, 24);
+    divisionSelector.setBounds(200, 90, 160, 24);
+    loadDisplay.setBounds(40, 140, 320, 20);
 }
@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "../Shared/LoadMeterDisplay.h"
 
 //==============================================================================
 /**
@@ -33,6 +34,9 @@ private:
     juce::Slider rateSlider;
     juce::Label depthLabel;
     juce::Label rateLabel;
+    juce::ToggleButton syncButton { "Sync to tempo" };
+    juce::ComboBox divisionSelector;
+    LoadMeterDisplay loadDisplay;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TremoloAudioProcessorEditor)
 };
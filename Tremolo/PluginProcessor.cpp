@@ -8,13 +8,32 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "../Shared/FastMath.h"
+#include "../Shared/RealtimeSafety.h"
+
+namespace
+{
+    const juce::uint16 stateVersion = 1;
+
+    // The keys are in saved states, so never renumber or reuse one.
+    enum : juce::uint16
+    {
+        depthKey = 1,
+        rateKey = 2,
+        tempoSyncKey = 3,
+        syncDivisionKey = 4
+    };
+
+    // Beats per LFO cycle, for each of syncDivision's choices.
+    const double syncBeats[] = { 4.0, 2.0, 1.0, 0.5, 0.25, 2.0 / 3.0, 1.0 / 3.0 };
+}
 
 //==============================================================================
 TremoloAudioProcessor::TremoloAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
+                      #if ! JucePlugin_IsSynth || EMBEDDED_ENGINE
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
@@ -24,6 +43,10 @@ TremoloAudioProcessor::TremoloAudioProcessor()
 {
     addParameter(depth = new juce::AudioParameterFloat("depth", "Depth", 0.0f, 1.0f, 0.5f));
     addParameter(rate = new juce::AudioParameterFloat("rate", "Rate", 0.1f, 10.0f, 2.0f));
+    addParameter(tempoSync = new juce::AudioParameterBool("tempoSync", "Tempo Sync", false));
+    addParameter(syncDivision = new juce::AudioParameterChoice("syncDivision", "Sync Division",
+        juce::StringArray { "1 bar", "1/2", "1/4", "1/8", "1/16", "1/4 triplet", "1/8 triplet" }, 2));
+    jassert(syncDivision->choices.size() == juce::numElementsInArray(syncBeats));
 }
 
 TremoloAudioProcessor::~TremoloAudioProcessor()
@@ -97,6 +120,13 @@ void TremoloAudioProcessor::prepareToPlay (double newSampleRate, int samplesPerB
 {
     sampleRate = newSampleRate;
     phase = 0.0f;
+    lfo.assign((size_t)juce::jmax(1, samplesPerBlock), 0.0f);
+    depthSmoother.reset(newSampleRate, smoothingSeconds);
+    depthSmoother.setCurrentAndTargetValue(*depth);
+    rateSmoother.reset(newSampleRate, smoothingSeconds);
+    // The playhead is only valid in processBlock, which syncs to it from the first block.
+    rateSmoother.setCurrentAndTargetValue(*rate);
+    loadMeter.prepare(newSampleRate);
 }
 
 void TremoloAudioProcessor::releaseResources()
@@ -121,7 +151,7 @@ bool TremoloAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
         return false;
 
     // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
+   #if ! JucePlugin_IsSynth || EMBEDDED_ENGINE
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
    #endif
@@ -133,26 +163,110 @@ bool TremoloAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void TremoloAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    const RealtimeSafety::ScopedCheck realtimeCheck;
+    const LoadMeter::ScopedTimer loadTimer(loadMeter, buffer.getNumSamples());
     const int numSamples = buffer.getNumSamples();
-    const float currentDepth = *depth;
-    const float currentRate = *rate;
+    const int numChannels = juce::jmin(buffer.getNumChannels(), getTotalNumOutputChannels());
+
+    jassert(!lfo.empty());
+    if (lfo.empty())
+        return;
+
+    Position position;
+    if (auto* playHead = getPlayHead())
+        position = playHead->getPosition();
+
+    depthSmoother.setTargetValue(*depth);
+    rateSmoother.setTargetValue(getRate(position));
+    const auto syncedCycles = getSyncedCycles(position);
+    if (syncedCycles.hasValue())
+    {
+        // Placed from the host's position every block, so it stays on the beat through
+        // loops and jumps; and at the tempo's rate straight away, with nothing to glide.
+        phase = (float)(*syncedCycles - std::floor(*syncedCycles));
+        rateSmoother.setCurrentAndTargetValue(rateSmoother.getTargetValue());
+    }
+    const float inverseSampleRate = (float)(1.0 / sampleRate);
 
-    for (int channel = 0; channel < getTotalNumOutputChannels(); ++channel)
+    // Hosts may exceed the block size they announced, so work in scratch-sized runs.
+    for (int start = 0; start < numSamples; start += (int)lfo.size())
     {
-        float* channelData = buffer.getWritePointer(channel);
+        const int length = juce::jmin((int)lfo.size(), numSamples - start);
+        float* const gain = lfo.data();
 
-        for (int sample = 0; sample < numSamples; ++sample)
+        // One phase for all the channels, so stereo stays in step and at the set rate.
+        if (rateSmoother.isSmoothing())
         {
-            const float modulator = (1.0f + std::sin(2.0f * juce::MathConstants<float>::pi * phase)) * 0.5f;
-            channelData[sample] *= 1.0f - (currentDepth * modulator);
+            for (int i = 0; i < length; ++i)
+            {
+                gain[i] = phase;
+                phase += rateSmoother.getNextValue() * inverseSampleRate;
+                if (phase >= 1.0f)
+                    phase -= 1.0f;
+            }
+        }
+        else
+        {
+            const float increment = rateSmoother.getTargetValue() * inverseSampleRate;
+            for (int i = 0; i < length; ++i)
+            {
+                gain[i] = phase;
+                phase += increment;
+                if (phase >= 1.0f)
+                    phase -= 1.0f;
+            }
+        }
 
-            phase += currentRate / sampleRate;
-            if (phase >= 1.0f)
-                phase -= 1.0f;
+        // The sines of the whole run in one call, then 1 - depth * (1 + sine) / 2.
+        FastMath::sin(gain, gain, length);
+        if (depthSmoother.isSmoothing())
+        {
+            for (int i = 0; i < length; ++i)
+            {
+                const float halfDepth = 0.5f * depthSmoother.getNextValue();
+                gain[i] = 1.0f - halfDepth - halfDepth * gain[i];
+            }
+        }
+        else
+        {
+            const float halfDepth = 0.5f * depthSmoother.getTargetValue();
+            juce::FloatVectorOperations::multiply(gain, -halfDepth, length);
+            juce::FloatVectorOperations::add(gain, 1.0f - halfDepth, length);
         }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel, start), gain, length);
     }
 }
 
+double TremoloAudioProcessor::getBeatsPerCycle() const
+{
+    return syncBeats[juce::jlimit(0, juce::numElementsInArray(syncBeats) - 1, syncDivision->getIndex())];
+}
+
+float TremoloAudioProcessor::getRate(const Position& position) const
+{
+    // Without a host tempo, rate still applies.
+    const auto bpm = position.hasValue() ? position->getBpm() : juce::Optional<double>();
+    if (!*tempoSync || !bpm.hasValue() || *bpm <= 0.0)
+        return *rate;
+
+    return (float)(*bpm / (60.0 * getBeatsPerCycle()));
+}
+
+juce::Optional<double> TremoloAudioProcessor::getSyncedCycles(const Position& position) const
+{
+    if (!*tempoSync || !position.hasValue() || !position->getIsPlaying())
+        return {};
+
+    const auto bpm = position->getBpm();
+    const auto ppq = position->getPpqPosition();
+    if (!bpm.hasValue() || *bpm <= 0.0 || !ppq.hasValue())
+        return {};
+
+    return *ppq / getBeatsPerCycle();
+}
+
 //==============================================================================
 bool TremoloAudioProcessor::hasEditor() const
 {
@@ -167,20 +281,37 @@ juce::AudioProcessorEditor* TremoloAudioProcessor::createEditor()
 //==============================================================================
 void TremoloAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    PluginState::Writer writer(destData, stateTag, stateVersion);
+    writer.add(depthKey, *depth);
+    writer.add(rateKey, *rate);
+    writer.add(tempoSyncKey, *tempoSync ? 1.0f : 0.0f);
+    writer.add(syncDivisionKey, (float)syncDivision->getIndex());
 }
 
 void TremoloAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // Parameters clamp what they are given, so a value from a damaged state stays in range.
+    const PluginState::Reader reader(data, sizeInBytes, stateTag);
+    for (int i = 0; i < reader.getNumFields(); ++i)
+    {
+        switch (reader.getKey(i))
+        {
+        case depthKey:          *depth = reader.getValue(i); break;
+        case rateKey:           *rate = reader.getValue(i); break;
+        case tempoSyncKey:      *tempoSync = reader.getValue(i) >= 0.5f; break;
+        case syncDivisionKey:   *syncDivision = juce::roundToInt(reader.getValue(i)); break;
+        default:                break;
+        }
+    }
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
+// Targets that build this processor in as a stage of their own define EMBEDDED_ENGINE=1;
+// it is an effect there even when that target is an instrument, so it keeps its input.
+#if ! EMBEDDED_ENGINE
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new TremoloAudioProcessor();
 }
+#endif
@@ -9,6 +9,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <vector>
+#include "../Shared/LoadMeter.h"
+#include "../Shared/PluginState.h"
 
 //==============================================================================
 /**
@@ -50,14 +53,36 @@ public:
     void changeProgramName (int index, const juce::String& newName) override;
 
     //==============================================================================
+    // A PluginState with this tag. Before it, nothing was saved.
+    static constexpr juce::uint32 stateTag = PluginState::makeTag("Trem");
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    // processBlock's DSP load, for the editor and for tests.
+    LoadMeter loadMeter;
+
     juce::AudioParameterFloat* depth;
     juce::AudioParameterFloat* rate;
+    // When the host has a tempo, the LFO runs one cycle per syncDivision of it instead of
+    // at rate, and while it plays, in step with its position.
+    juce::AudioParameterBool* tempoSync;
+    juce::AudioParameterChoice* syncDivision;
+
+    // Depth and rate glide over smoothingSeconds.
+    static constexpr double smoothingSeconds = 0.05;
+
 private:
-    float phase;
-    float sampleRate;
+    using Position = juce::Optional<juce::AudioPlayHead::PositionInfo>;
+    // The LFO's rate in Hz at the host's position: rate, or the synced rate when the host has a tempo.
+    float getRate(const Position& position) const;
+    // Where in its cycle the synced LFO is while the host plays; nothing otherwise.
+    juce::Optional<double> getSyncedCycles(const Position& position) const;
+    double getBeatsPerCycle() const;
+
+    float phase = 0.0f;         // cycles, shared by every channel
+    double sampleRate = 44100.0;
+    juce::SmoothedValue<float> depthSmoother, rateSmoother;
+    std::vector<float> lfo;     // one run of LFO phases, then the gain curve
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TremoloAudioProcessor)
 };